@@ -0,0 +1,206 @@
+#ifndef AFFINE_HPP
+#define AFFINE_HPP
+
+#include "math_utils.hpp"
+#include "matrix.hpp"
+#include "ray.hpp"
+#include "vec.hpp"
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <iomanip>
+#include <stdexcept>
+
+namespace rtm {
+// The top three rows of a 4x4 transform whose bottom row is 0 0 0 1, which is
+// every transform the matrix_translate/scale/shear/rotate builders produce.
+// Holds 12 values instead of 16 and skips the bottom row in every product.
+template <std::floating_point T = real> class affine {
+public:
+  constexpr affine() = default;
+
+  constexpr explicit affine(const matrix<4, 4, T> &mat) {
+    if (!is_affine_matrix(mat))
+      throw std::domain_error("Affine transform requires a 0 0 0 1 bottom row");
+
+    for (size_t r = 0; r < 3; ++r)
+      for (size_t c = 0; c < 4; ++c)
+        (*this)(r, c) = mat(r, c);
+  }
+
+  [[nodiscard]] constexpr const T &operator()(const size_t row,
+                                              const size_t col) const {
+    return m_data[row * 4 + col];
+  }
+
+  [[nodiscard]] constexpr T &operator()(const size_t row, const size_t col) {
+    return m_data[row * 4 + col];
+  }
+
+  [[nodiscard]] constexpr matrix<4, 4, T> to_matrix() const {
+    auto temporary{identity_matrix<4, T>()};
+
+    for (size_t r = 0; r < 3; ++r)
+      for (size_t c = 0; c < 4; ++c)
+        temporary(r, c) = (*this)(r, c);
+
+    return temporary;
+  }
+
+  // w is 1 in and out
+  [[nodiscard]] constexpr vec<4, T> transform_point(const vec<4, T> &p) const {
+    return {row(0, p) + m_data[3], row(1, p) + m_data[7], row(2, p) + m_data[11],
+            T{1}};
+  }
+
+  // w is 0 in and out, translation does not apply
+  [[nodiscard]] constexpr vec<4, T>
+  transform_direction(const vec<4, T> &d) const {
+    return {row(0, d), row(1, d), row(2, d), T{}};
+  }
+
+  // By the transpose of the linear part; on an inverse transform this maps
+  // object-space normals to world space
+  [[nodiscard]] constexpr vec<4, T>
+  transform_normal(const vec<4, T> &n) const {
+    return {m_data[0] * n[0] + m_data[4] * n[1] + m_data[8] * n[2],
+            m_data[1] * n[0] + m_data[5] * n[1] + m_data[9] * n[2],
+            m_data[2] * n[0] + m_data[6] * n[1] + m_data[10] * n[2], T{}};
+  }
+
+  // Same result as the full 4x4 product, whatever w is
+  [[nodiscard]] constexpr vec<4, T> operator*(const vec<4, T> &v) const {
+    return {row(0, v) + m_data[3] * v[3], row(1, v) + m_data[7] * v[3],
+            row(2, v) + m_data[11] * v[3], v[3]};
+  }
+
+  constexpr affine &operator*=(const affine &rhs) {
+    const affine lhs = *this;
+
+    for (size_t r = 0; r < 3; ++r) {
+      for (size_t c = 0; c < 4; ++c) {
+        T value = lhs(r, 0) * rhs(0, c) + lhs(r, 1) * rhs(1, c) +
+                  lhs(r, 2) * rhs(2, c);
+        // rhs' implicit bottom row contributes only to the translation
+        if (c == 3)
+          value += lhs(r, 3);
+        (*this)(r, c) = value;
+      }
+    }
+
+    return *this;
+  }
+
+  [[nodiscard]] friend constexpr affine operator*(affine lhs,
+                                                  const affine &rhs) {
+    lhs *= rhs;
+    return lhs;
+  }
+
+  [[nodiscard]] constexpr bool operator==(const affine &rhs) const {
+    return std::ranges::equal(m_data, rhs.m_data, [](const T &a, const T &b) {
+      return are_close(a, b);
+    });
+  }
+
+  [[nodiscard]] friend constexpr bool operator==(const affine &lhs,
+                                                 const matrix<4, 4, T> &rhs) {
+    return is_affine_matrix(rhs) && lhs.to_matrix() == rhs;
+  }
+
+  friend std::ostream &operator<<(std::ostream &os, const affine &rhs) {
+    return os << rhs.to_matrix();
+  }
+
+private:
+  std::array<T, 12> m_data{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0};
+
+  [[nodiscard]] constexpr T row(const size_t r, const vec<4, T> &v) const {
+    return m_data[r * 4] * v[0] + m_data[r * 4 + 1] * v[1] +
+           m_data[r * 4 + 2] * v[2];
+  }
+};
+
+// What a transform does, cheapest first. uniform_scale is a positive
+// uniform scale followed by any translation. Matching is exact: a transform
+// that only nearly fits a class is general, which is always safe.
+enum class transform_class : uint8_t {
+  identity,
+  translation,
+  uniform_scale,
+  general
+};
+
+inline std::ostream &operator<<(std::ostream &os, const transform_class c) {
+  constexpr std::array<const char *, 4> names{"identity", "translation",
+                                              "uniform_scale", "general"};
+  return os << names[static_cast<size_t>(c)];
+}
+
+template <std::floating_point T>
+[[nodiscard]] constexpr transform_class classify(const affine<T> &a) {
+  const T scale = a(0, 0);
+
+  for (size_t r = 0; r < 3; ++r)
+    for (size_t c = 0; c < 3; ++c)
+      if (a(r, c) != (r == c ? scale : T{}))
+        return transform_class::general;
+
+  if (!(scale > 0))
+    return transform_class::general;
+  if (scale != 1)
+    return transform_class::uniform_scale;
+
+  const bool moves = a(0, 3) != 0 || a(1, 3) != 0 || a(2, 3) != 0;
+  return moves ? transform_class::translation : transform_class::identity;
+}
+
+template <typename V = void> struct AffineInverse {
+  template <std::floating_point T>
+  [[nodiscard]] constexpr affine<T> operator()(const affine<T> &a) {
+    affine<T> temporary;
+
+    detail::invert_affine_rows<T>(a, temporary);
+
+    return temporary;
+  }
+};
+
+template <std::floating_point T>
+[[nodiscard]] constexpr affine<T> affine_inverse(const affine<T> &a) {
+  return AffineInverse{}(a);
+}
+
+// Transpose of the linear part of an inverse transform, i.e. the normal
+// matrix of the forward one
+template <std::floating_point T>
+[[nodiscard]] constexpr matrix<3, 3, T>
+normal_matrix(const affine<T> &inverse) {
+  matrix<3, 3, T> temporary;
+
+  for (size_t r = 0; r < 3; ++r)
+    for (size_t c = 0; c < 3; ++c)
+      temporary(r, c) = inverse(c, r);
+
+  return temporary;
+}
+
+// Object-space normal to world space, not normalized; w comes out 0
+template <std::floating_point T>
+[[nodiscard]] constexpr vec<4, T> apply_normal_matrix(const matrix<3, 3, T> &m,
+                                                      const vec<4, T> &n) {
+  return {m(0, 0) * n[0] + m(0, 1) * n[1] + m(0, 2) * n[2],
+          m(1, 0) * n[0] + m(1, 1) * n[1] + m(1, 2) * n[2],
+          m(2, 0) * n[0] + m(2, 1) * n[1] + m(2, 2) * n[2], T{}};
+}
+
+template <std::floating_point T>
+[[nodiscard]] constexpr ray<T> transform_ray(const affine<T> &a,
+                                             const ray<T> &r) {
+  return {.origin = a.transform_point(r.origin),
+          .direction = a.transform_direction(r.direction)};
+}
+} // namespace rtm
+
+#endif
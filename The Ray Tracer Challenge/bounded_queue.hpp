@@ -0,0 +1,75 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace rtm {
+// Multi-producer, multi-consumer FIFO holding at most capacity items. push()
+// blocks while the queue is full, which is how a slow consumer holds back
+// its producers. Once closed, pushes are refused and pops drain what is left.
+template <typename T> class bounded_queue {
+public:
+  explicit bounded_queue(const size_t capacity) : m_capacity{capacity} {
+    if (capacity == 0)
+      throw std::invalid_argument("bounded_queue requires a non-zero capacity");
+  }
+
+  bounded_queue(const bounded_queue &) = delete;
+  bounded_queue &operator=(const bounded_queue &) = delete;
+
+  [[nodiscard]] size_t capacity() const noexcept { return m_capacity; }
+
+  // False if the queue was closed before there was room
+  bool push(T value) {
+    {
+      std::unique_lock lock{m_mutex};
+      m_not_full.wait(lock,
+                      [this] { return m_closed || m_items.size() < m_capacity; });
+      if (m_closed)
+        return false;
+      m_items.push_back(std::move(value));
+    }
+    m_not_empty.notify_one();
+    return true;
+  }
+
+  // Empty once the queue is closed and drained
+  [[nodiscard]] std::optional<T> pop() {
+    std::optional<T> item;
+    {
+      std::unique_lock lock{m_mutex};
+      m_not_empty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+      if (m_items.empty())
+        return item;
+      item.emplace(std::move(m_items.front()));
+      m_items.pop_front();
+    }
+    m_not_full.notify_one();
+    return item;
+  }
+
+  void close() {
+    {
+      std::scoped_lock lock{m_mutex};
+      m_closed = true;
+    }
+    m_not_full.notify_all();
+    m_not_empty.notify_all();
+  }
+
+private:
+  size_t m_capacity;
+  std::mutex m_mutex{};
+  std::condition_variable m_not_full{};
+  std::condition_variable m_not_empty{};
+  std::deque<T> m_items{};
+  bool m_closed{false};
+};
+} // namespace rtm
+
+#endif
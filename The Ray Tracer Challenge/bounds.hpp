@@ -0,0 +1,143 @@
+#ifndef BOUNDS_HPP
+#define BOUNDS_HPP
+
+#include "affine.hpp"
+#include "matrix.hpp"
+#include "ray.hpp"
+#include "vec.hpp"
+#include <limits>
+#include <optional>
+#include <utility>
+
+namespace rtm {
+// Axis-aligned box; default constructed it is empty (min > max) so that
+// extend() works from the first point on
+template <std::floating_point T = real> struct aabb {
+  vec<3, T> min{filled(std::numeric_limits<T>::infinity())};
+  vec<3, T> max{filled(-std::numeric_limits<T>::infinity())};
+
+  [[nodiscard]] constexpr bool empty() const {
+    return min.x() > max.x() || min.y() > max.y() || min.z() > max.z();
+  }
+
+  constexpr aabb &extend(const vec<3, T> &point) {
+    for (size_t i = 0; i < 3; ++i) {
+      min[i] = point[i] < min[i] ? point[i] : min[i];
+      max[i] = point[i] > max[i] ? point[i] : max[i];
+    }
+    return *this;
+  }
+
+  constexpr aabb &extend(const aabb &box) {
+    for (size_t i = 0; i < 3; ++i) {
+      min[i] = box.min[i] < min[i] ? box.min[i] : min[i];
+      max[i] = box.max[i] > max[i] ? box.max[i] : max[i];
+    }
+    return *this;
+  }
+
+  [[nodiscard]] constexpr vec<3, T> centroid() const {
+    return (min + max) * T{0.5};
+  }
+
+  [[nodiscard]] constexpr vec<3, T> extent() const { return max - min; }
+
+  [[nodiscard]] constexpr T surface_area() const {
+    if (empty())
+      return T{};
+
+    const auto e = extent();
+    return T{2} * (e.x() * e.y() + e.y() * e.z() + e.z() * e.x());
+  }
+
+  [[nodiscard]] constexpr size_t longest_axis() const {
+    const auto e = extent();
+    if (e.x() >= e.y() && e.x() >= e.z())
+      return 0;
+    return e.y() >= e.z() ? 1 : 2;
+  }
+
+  [[nodiscard]] constexpr bool operator==(const aabb &) const = default;
+
+private:
+  static constexpr vec<3, T> filled(const T value) {
+    vec<3, T> temporary;
+    temporary.x() = temporary.y() = temporary.z() = value;
+    return temporary;
+  }
+};
+
+// Bounds of an affinely transformed box (Arvo): each output axis takes the
+// smaller/larger of every matrix term applied to the input interval
+template <typename V = void> struct TransformBounds {
+  // Mat is a matrix<4, 4, T> or an affine<T>, only the top rows are read
+  template <std::floating_point T, typename Mat>
+  [[nodiscard]] constexpr aabb<T> operator()(const Mat &mat,
+                                             const aabb<T> &box) {
+    if (box.empty())
+      return box;
+
+    aabb<T> temporary;
+
+    for (size_t r = 0; r < 3; ++r) {
+      temporary.min[r] = temporary.max[r] = mat(r, 3);
+
+      for (size_t c = 0; c < 3; ++c) {
+        const T a = mat(r, c) * box.min[c];
+        const T b = mat(r, c) * box.max[c];
+        temporary.min[r] += a < b ? a : b;
+        temporary.max[r] += a < b ? b : a;
+      }
+    }
+
+    return temporary;
+  }
+};
+
+template <std::floating_point T>
+[[nodiscard]] constexpr aabb<T> transform_bounds(const matrix<4, 4, T> &mat,
+                                                 const aabb<T> &box) {
+  return TransformBounds{}(mat, box);
+}
+
+template <std::floating_point T>
+[[nodiscard]] constexpr aabb<T> transform_bounds(const affine<T> &a,
+                                                 const aabb<T> &box) {
+  return TransformBounds{}(a, box);
+}
+
+// Reciprocal direction, computed once per ray and reused for every slab test
+template <std::floating_point T> struct ray_slab {
+  vec<3, T> origin;
+  vec<3, T> inverse_direction;
+
+  constexpr explicit ray_slab(const ray<T> &r)
+      : origin{r.origin.x(), r.origin.y(), r.origin.z()},
+        inverse_direction{T{1} / r.direction.x(), T{1} / r.direction.y(),
+                          T{1} / r.direction.z()} {}
+};
+
+// Entry distance of the ray into box within [t_min, t_max], or nothing
+template <std::floating_point T>
+[[nodiscard]] constexpr std::optional<T>
+slab_entry(const ray_slab<T> &r, const aabb<T> &box, T t_min, T t_max) {
+  for (size_t i = 0; i < 3; ++i) {
+    T t0 = (box.min[i] - r.origin[i]) * r.inverse_direction[i];
+    T t1 = (box.max[i] - r.origin[i]) * r.inverse_direction[i];
+    if (t0 > t1)
+      std::swap(t0, t1);
+
+    // Written so a NaN (origin on a slab plane, zero direction) keeps the
+    // interval unchanged instead of poisoning it
+    t_min = t0 > t_min ? t0 : t_min;
+    t_max = t1 < t_max ? t1 : t_max;
+
+    if (t_min > t_max)
+      return std::nullopt;
+  }
+
+  return t_min;
+}
+} // namespace rtm
+
+#endif
@@ -0,0 +1,698 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include "bounds.hpp"
+#include "hit.hpp"
+#include "intersection_list.hpp"
+#include "primitive.hpp"
+#include "scene_object.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace rtm {
+namespace constants {
+// Candidate split planes per axis for the binned SAH
+inline constexpr size_t BVH_BINS{16};
+inline constexpr size_t BVH_MAX_LEAF_SIZE{4};
+// Past this depth nodes are split at the median, which bounds the tree depth
+// (and the traversal stack) no matter how lopsided the SAH splits get
+inline constexpr size_t BVH_MAX_SAH_DEPTH{32};
+inline constexpr size_t BVH_STACK_SIZE{64};
+// Primitives per task in a parallel build: nodes above this size have their
+// passes split into chunks of it, subtrees below it are built by one worker
+inline constexpr size_t BVH_PARALLEL_GRAIN{1ULL << 12};
+} // namespace constants
+
+// Bounding volume hierarchy over scene objects, built top-down with a binned
+// surface area heuristic. Nodes are stored depth first: an interior node's
+// first child directly follows it, offset holds the second.
+class bvh {
+public:
+  struct node {
+    aabb<real> bounds{};
+    uint32_t offset{}; // leaf: first object, interior: second child
+    uint32_t count{};  // objects in a leaf, 0 for interior nodes
+  };
+
+  // How good a tree is and what it took to build. The SAH cost weighs a node
+  // visit and an object test alike, relative to the root's surface area.
+  struct statistics {
+    std::chrono::duration<double, std::milli> build_time{};
+    real sah_cost{};
+    size_t depth{}; // nodes on the longest root to leaf path
+    size_t node_count{};
+    size_t leaf_count{};
+    std::vector<size_t> leaf_sizes{}; // [n]: leaves holding n objects
+
+    friend std::ostream &operator<<(std::ostream &os,
+                                    const statistics &rhs) {
+      os << "bvh: " << rhs.node_count << " nodes, " << rhs.leaf_count
+         << " leaves, depth " << rhs.depth << ", SAH cost " << rhs.sah_cost
+         << ", built in " << rhs.build_time.count() << " ms\n"
+         << "leaf sizes:";
+      for (size_t n = 0; n < rhs.leaf_sizes.size(); ++n)
+        if (rhs.leaf_sizes[n] > 0)
+          os << ' ' << n << ':' << rhs.leaf_sizes[n];
+      return os;
+    }
+  };
+
+  bvh() = default;
+
+  explicit bvh(std::vector<std::shared_ptr<object>> objects,
+               const size_t max_leaf_size = constants::BVH_MAX_LEAF_SIZE) {
+    const auto start = std::chrono::steady_clock::now();
+    if (!prepare(objects, max_leaf_size))
+      return;
+
+    std::vector<primitive> primitives(objects.size());
+    gather(objects, primitives, 0, objects.size());
+
+    m_nodes.reserve(2 * objects.size() - 1);
+    build(primitives, 0, primitives.size(), 0, max_leaf_size, m_nodes);
+
+    m_objects.resize(objects.size());
+    reorder(objects, primitives, 0, objects.size());
+    m_build_time = std::chrono::steady_clock::now() - start;
+  }
+
+  // Same tree quality, built on pool: the top of the tree one node at a
+  // time with every pass over its primitives split across the workers, then
+  // each subtree below BVH_PARALLEL_GRAIN primitives as a task of its own.
+  // Not to be called from a worker of pool.
+  bvh(std::vector<std::shared_ptr<object>> objects, thread_pool &pool,
+      const size_t max_leaf_size = constants::BVH_MAX_LEAF_SIZE) {
+    const auto start = std::chrono::steady_clock::now();
+    if (!prepare(objects, max_leaf_size))
+      return;
+
+    std::vector<primitive> primitives(objects.size());
+    for_each_chunk(pool, 0, objects.size(),
+                   [&](size_t, const size_t begin, const size_t end) {
+                     gather(objects, primitives, begin, end);
+                   });
+
+    std::vector<primitive> scratch(primitives.size());
+    std::vector<node> top;
+    std::vector<subtree> subtrees;
+    build_top(pool, primitives, scratch, 0, primitives.size(), 0,
+              max_leaf_size, top, subtrees);
+
+    pool.parallel_for(0, subtrees.size(), [&](const size_t i) {
+      auto &sub = subtrees[i];
+      sub.nodes.reserve(2 * (sub.end - sub.begin) - 1);
+      build(primitives, sub.begin, sub.end, sub.depth, max_leaf_size,
+            sub.nodes);
+    });
+
+    m_nodes.reserve(2 * objects.size() - 1);
+    flatten(top, subtrees);
+
+    m_objects.resize(objects.size());
+    for_each_chunk(pool, 0, objects.size(),
+                   [&](size_t, const size_t begin, const size_t end) {
+                     reorder(objects, primitives, begin, end);
+                   });
+    m_build_time = std::chrono::steady_clock::now() - start;
+  }
+
+  [[nodiscard]] bool empty() const { return m_nodes.empty(); }
+
+  [[nodiscard]] const std::vector<node> &nodes() const { return m_nodes; }
+
+  [[nodiscard]] const std::vector<std::shared_ptr<object>> &objects() const {
+    return m_objects;
+  }
+
+  [[nodiscard]] statistics stats() const {
+    statistics result;
+    result.build_time = m_build_time;
+    result.node_count = m_nodes.size();
+    if (m_nodes.empty())
+      return result;
+
+    const real root_area = m_nodes[0].bounds.surface_area();
+    const auto relative_area = [root_area](const node &n) {
+      return root_area > 0 ? n.bounds.surface_area() / root_area : real{1};
+    };
+
+    // Each entry is a node and its depth counted from 1 at the root
+    std::vector<std::pair<uint32_t, size_t>> pending{{0, 1}};
+    while (!pending.empty()) {
+      const auto [index, depth] = pending.back();
+      pending.pop_back();
+
+      const node &current = m_nodes[index];
+      result.depth = std::max(result.depth, depth);
+
+      if (current.count > 0) {
+        ++result.leaf_count;
+        if (result.leaf_sizes.size() <= current.count)
+          result.leaf_sizes.resize(current.count + 1);
+        ++result.leaf_sizes[current.count];
+        result.sah_cost +=
+            relative_area(current) * static_cast<real>(current.count);
+        continue;
+      }
+
+      result.sah_cost += relative_area(current);
+      pending.emplace_back(index + 1, depth + 1);
+      pending.emplace_back(current.offset, depth + 1);
+    }
+
+    return result;
+  }
+
+  // Nearest non-negative hit, same result as the linear closest_hit()
+  [[nodiscard]] std::optional<rtm::intersect>
+  closest_hit(const ray<real> &r) const {
+    std::optional<rtm::intersect> closest;
+    if (m_nodes.empty())
+      return closest;
+
+    const ray_slab<real> slab{r};
+    real t_max = std::numeric_limits<real>::infinity();
+
+    struct entry {
+      uint32_t index;
+      real t;
+    };
+    std::array<entry, constants::BVH_STACK_SIZE> stack;
+    size_t top = 0;
+
+    const auto root = slab_entry(slab, m_nodes[0].bounds, real{}, t_max);
+    if (!root)
+      return closest;
+    stack[top++] = {0, *root};
+
+    while (top > 0) {
+      const auto [index, t_entry] = stack[--top];
+      // Something closer was found since this node was pushed
+      if (t_entry > t_max)
+        continue;
+
+      const node &current = m_nodes[index];
+
+      if (current.count > 0) {
+        for (uint32_t i = current.offset; i < current.offset + current.count;
+             ++i) {
+          if (const auto xs = dispatch_intersect(*m_objects[i], r)) {
+            if (const auto h = hit(*xs); h && h->t < t_max) {
+              closest = h;
+              t_max = h->t;
+            }
+          }
+        }
+        continue;
+      }
+
+      const uint32_t left = index + 1;
+      const uint32_t right = current.offset;
+      const auto t_left = slab_entry(slab, m_nodes[left].bounds, real{}, t_max);
+      const auto t_right =
+          slab_entry(slab, m_nodes[right].bounds, real{}, t_max);
+
+      // Far child first so the near one is popped next
+      if (t_left && t_right) {
+        if (*t_left <= *t_right) {
+          stack[top++] = {right, *t_right};
+          stack[top++] = {left, *t_left};
+        } else {
+          stack[top++] = {left, *t_left};
+          stack[top++] = {right, *t_right};
+        }
+      } else if (t_left) {
+        stack[top++] = {left, *t_left};
+      } else if (t_right) {
+        stack[top++] = {right, *t_right};
+      }
+    }
+
+    return closest;
+  }
+
+  // Some object hit at a t in [0, t_max), or nullptr. Stops at the first one
+  // found, which need not be the nearest; no ordering, no t bookkeeping.
+  [[nodiscard]] const object *any_hit(const ray<real> &r,
+                                      const real t_max) const {
+    if (m_nodes.empty())
+      return nullptr;
+
+    const ray_slab<real> slab{r};
+    std::array<uint32_t, constants::BVH_STACK_SIZE> stack;
+    size_t top = 0;
+
+    if (!slab_entry(slab, m_nodes[0].bounds, real{}, t_max))
+      return nullptr;
+    stack[top++] = 0;
+
+    while (top > 0) {
+      const uint32_t index = stack[--top];
+      const node &current = m_nodes[index];
+
+      if (current.count > 0) {
+        for (uint32_t i = current.offset; i < current.offset + current.count;
+             ++i)
+          if (occludes(*m_objects[i], r, t_max))
+            return m_objects[i].get();
+        continue;
+      }
+
+      for (const uint32_t child : {index + 1, current.offset})
+        if (slab_entry(slab, m_nodes[child].bounds, real{}, t_max))
+          stack[top++] = child;
+    }
+
+    return nullptr;
+  }
+
+  // Appends every root of every object whose bounds the ray reaches at
+  // t >= 0, in traversal order; out is not cleared first
+  template <size_t N>
+  void intersect_all(const ray<real> &r,
+                     intersection_list<rtm::intersect, N> &out) const {
+    if (m_nodes.empty())
+      return;
+
+    const ray_slab<real> slab{r};
+    const real t_max = std::numeric_limits<real>::infinity();
+    std::array<uint32_t, constants::BVH_STACK_SIZE> stack;
+    size_t top = 0;
+
+    if (!slab_entry(slab, m_nodes[0].bounds, real{}, t_max))
+      return;
+    stack[top++] = 0;
+
+    while (top > 0) {
+      const uint32_t index = stack[--top];
+      const node &current = m_nodes[index];
+
+      if (current.count > 0) {
+        for (uint32_t i = current.offset; i < current.offset + current.count;
+             ++i)
+          if (const auto xs = dispatch_intersect(*m_objects[i], r))
+            out.append(*xs);
+        continue;
+      }
+
+      for (const uint32_t child : {index + 1, current.offset})
+        if (slab_entry(slab, m_nodes[child].bounds, real{}, t_max))
+          stack[top++] = child;
+    }
+  }
+
+private:
+  struct primitive {
+    aabb<real> bounds;
+    vec<3, real> centroid;
+    uint32_t index;
+  };
+
+  struct bin {
+    aabb<real> bounds{};
+    size_t count{};
+  };
+
+  // Bins along each axis; axes whose centroids do not spread stay empty
+  using bin_grid = std::array<std::array<bin, constants::BVH_BINS>, 3>;
+
+  struct split_plane {
+    size_t axis;
+    size_t bin; // first bin on the right
+  };
+
+  // A range left to build on its own once the top of the tree is done
+  struct subtree {
+    uint32_t top_index; // its placeholder in the top nodes
+    size_t begin;
+    size_t end;
+    size_t depth;
+    std::vector<node> nodes{};
+  };
+
+  std::vector<node> m_nodes{};
+  std::vector<std::shared_ptr<object>> m_objects{};
+  std::chrono::duration<double, std::milli> m_build_time{};
+
+  // Checks the arguments; false if there is nothing to build
+  static bool prepare(const std::vector<std::shared_ptr<object>> &objects,
+                      const size_t max_leaf_size) {
+    if (max_leaf_size == 0)
+      throw std::invalid_argument("bvh: leaf size must be positive");
+    if (objects.size() > std::numeric_limits<uint32_t>::max())
+      throw std::length_error("bvh: too many objects");
+
+    return !objects.empty();
+  }
+
+  static void gather(const std::vector<std::shared_ptr<object>> &objects,
+                     std::vector<primitive> &primitives, const size_t begin,
+                     const size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const auto box = objects[i]->bounds();
+      primitives[i] = {box, box.centroid(), static_cast<uint32_t>(i)};
+    }
+  }
+
+  // Leaves index a contiguous run, so the objects are stored in leaf order
+  void reorder(std::vector<std::shared_ptr<object>> &objects,
+               const std::vector<primitive> &primitives, const size_t begin,
+               const size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      m_objects[i] = std::move(objects[primitives[i].index]);
+  }
+
+  // f(chunk, begin, end) for every BVH_PARALLEL_GRAIN sized piece of
+  // [begin, end), on pool
+  template <typename F>
+  static void for_each_chunk(thread_pool &pool, const size_t begin,
+                             const size_t end, F &&f) {
+    constexpr size_t G = constants::BVH_PARALLEL_GRAIN;
+
+    pool.parallel_for(0, chunk_count(begin, end), [&](const size_t chunk) {
+      const size_t chunk_begin = begin + chunk * G;
+      f(chunk, chunk_begin, std::min(end, chunk_begin + G));
+    });
+  }
+
+  static size_t chunk_count(const size_t begin, const size_t end) {
+    constexpr size_t G = constants::BVH_PARALLEL_GRAIN;
+    return (end - begin + G - 1) / G;
+  }
+
+  static uint32_t build(std::vector<primitive> &primitives,
+                        const size_t begin, const size_t end,
+                        const size_t depth, const size_t max_leaf_size,
+                        std::vector<node> &nodes) {
+    const auto node_index = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+
+    aabb<real> box;
+    aabb<real> centroids;
+    for (size_t i = begin; i < end; ++i) {
+      box.extend(primitives[i].bounds);
+      centroids.extend(primitives[i].centroid);
+    }
+    nodes[node_index].bounds = box;
+
+    const size_t count = end - begin;
+    if (count <= max_leaf_size) {
+      nodes[node_index].offset = static_cast<uint32_t>(begin);
+      nodes[node_index].count = static_cast<uint32_t>(count);
+      return node_index;
+    }
+
+    size_t middle = 0;
+    if (depth < constants::BVH_MAX_SAH_DEPTH) {
+      bin_grid grid{};
+      fill_bins(primitives, begin, end, centroids, grid);
+      if (const auto plane = choose_split(grid))
+        middle = partition(primitives, begin, end, centroids, *plane);
+    }
+
+    // Every centroid in one bin, or too deep: halve the range instead
+    if (middle == 0)
+      middle = split_median(primitives, begin, end, centroids);
+
+    build(primitives, begin, middle, depth + 1, max_leaf_size, nodes);
+    nodes[node_index].offset =
+        build(primitives, middle, end, depth + 1, max_leaf_size, nodes);
+
+    return node_index;
+  }
+
+  // build() for the nodes above BVH_PARALLEL_GRAIN primitives, with the
+  // bounds pre-pass, binning and partitioning each split across pool.
+  // Smaller ranges get a placeholder node and are queued in subtrees.
+  static uint32_t build_top(thread_pool &pool,
+                            std::vector<primitive> &primitives,
+                            std::vector<primitive> &scratch,
+                            const size_t begin, const size_t end,
+                            const size_t depth, const size_t max_leaf_size,
+                            std::vector<node> &nodes,
+                            std::vector<subtree> &subtrees) {
+    const auto node_index = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+
+    const size_t count = end - begin;
+    if (count <= constants::BVH_PARALLEL_GRAIN || count <= max_leaf_size) {
+      subtrees.push_back({node_index, begin, end, depth});
+      return node_index;
+    }
+
+    const size_t chunks = chunk_count(begin, end);
+
+    std::vector<aabb<real>> boxes(chunks);
+    std::vector<aabb<real>> centroid_boxes(chunks);
+    for_each_chunk(pool, begin, end,
+                   [&](const size_t chunk, const size_t b, const size_t e) {
+                     for (size_t i = b; i < e; ++i) {
+                       boxes[chunk].extend(primitives[i].bounds);
+                       centroid_boxes[chunk].extend(primitives[i].centroid);
+                     }
+                   });
+
+    aabb<real> centroids;
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+      nodes[node_index].bounds.extend(boxes[chunk]);
+      centroids.extend(centroid_boxes[chunk]);
+    }
+
+    size_t middle = 0;
+    if (depth < constants::BVH_MAX_SAH_DEPTH) {
+      std::vector<bin_grid> grids(chunks);
+      for_each_chunk(pool, begin, end,
+                     [&](const size_t chunk, const size_t b, const size_t e) {
+                       fill_bins(primitives, b, e, centroids, grids[chunk]);
+                     });
+
+      for (size_t chunk = 1; chunk < chunks; ++chunk)
+        for (size_t axis = 0; axis < 3; ++axis)
+          for (size_t b = 0; b < constants::BVH_BINS; ++b) {
+            grids[0][axis][b].bounds.extend(grids[chunk][axis][b].bounds);
+            grids[0][axis][b].count += grids[chunk][axis][b].count;
+          }
+
+      if (const auto plane = choose_split(grids[0]))
+        middle = partition_parallel(pool, primitives, scratch, begin, end,
+                                    centroids, *plane);
+    }
+
+    if (middle == 0)
+      middle = split_median(primitives, begin, end, centroids);
+
+    build_top(pool, primitives, scratch, begin, middle, depth + 1,
+              max_leaf_size, nodes, subtrees);
+    nodes[node_index].offset =
+        build_top(pool, primitives, scratch, middle, end, depth + 1,
+                  max_leaf_size, nodes, subtrees);
+
+    return node_index;
+  }
+
+  // Lays the top nodes out depth first with each subtree spliced in at its
+  // placeholder
+  void flatten(const std::vector<node> &top,
+               const std::vector<subtree> &subtrees) {
+    constexpr auto NONE = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> subtree_at(top.size(), NONE);
+    for (size_t i = 0; i < subtrees.size(); ++i)
+      subtree_at[subtrees[i].top_index] = static_cast<uint32_t>(i);
+
+    const auto emit = [&](const auto &self, const uint32_t index) -> uint32_t {
+      const auto base = static_cast<uint32_t>(m_nodes.size());
+
+      if (subtree_at[index] != NONE) {
+        for (node n : subtrees[subtree_at[index]].nodes) {
+          if (n.count == 0)
+            n.offset += base;
+          m_nodes.push_back(n);
+        }
+        return base;
+      }
+
+      m_nodes.push_back(top[index]);
+      self(self, index + 1);
+      const uint32_t right = self(self, top[index].offset);
+      m_nodes[base].offset = right;
+      return base;
+    };
+
+    emit(emit, 0);
+  }
+
+  static void fill_bins(const std::vector<primitive> &primitives,
+                        const size_t begin, const size_t end,
+                        const aabb<real> &centroids, bin_grid &grid) {
+    for (size_t axis = 0; axis < 3; ++axis) {
+      const real extent = centroids.max[axis] - centroids.min[axis];
+      if (!(extent > 0))
+        continue;
+
+      for (size_t i = begin; i < end; ++i) {
+        auto &b = grid[axis][bin_of(primitives[i], axis, centroids, extent)];
+        b.bounds.extend(primitives[i].bounds);
+        ++b.count;
+      }
+    }
+  }
+
+  // The cheapest bin boundary over all three axes, if any separates
+  // something
+  static std::optional<split_plane> choose_split(const bin_grid &grid) {
+    constexpr size_t B = constants::BVH_BINS;
+
+    real best_cost = std::numeric_limits<real>::infinity();
+    std::optional<split_plane> best;
+
+    for (size_t axis = 0; axis < 3; ++axis) {
+      const auto &bins = grid[axis];
+
+      // Sweep from the right to get the cost of every right-hand side, then
+      // from the left to combine
+      std::array<real, B> right_area{};
+      std::array<size_t, B> right_count{};
+      aabb<real> accumulated;
+      size_t accumulated_count = 0;
+      for (size_t b = B - 1; b > 0; --b) {
+        accumulated.extend(bins[b].bounds);
+        accumulated_count += bins[b].count;
+        right_area[b] = accumulated.surface_area();
+        right_count[b] = accumulated_count;
+      }
+
+      accumulated = {};
+      accumulated_count = 0;
+      for (size_t split = 1; split < B; ++split) {
+        accumulated.extend(bins[split - 1].bounds);
+        accumulated_count += bins[split - 1].count;
+        if (accumulated_count == 0 || right_count[split] == 0)
+          continue;
+
+        const real cost =
+            accumulated.surface_area() * static_cast<real>(accumulated_count) +
+            right_area[split] * static_cast<real>(right_count[split]);
+        if (cost < best_cost) {
+          best_cost = cost;
+          best = split_plane{axis, split};
+        }
+      }
+    }
+
+    return best;
+  }
+
+  // Returns the split point
+  static size_t partition(std::vector<primitive> &primitives,
+                          const size_t begin, const size_t end,
+                          const aabb<real> &centroids,
+                          const split_plane &plane) {
+    const real extent =
+        centroids.max[plane.axis] - centroids.min[plane.axis];
+    const auto middle = std::partition(
+        primitives.begin() + static_cast<ptrdiff_t>(begin),
+        primitives.begin() + static_cast<ptrdiff_t>(end),
+        [&](const primitive &p) {
+          return bin_of(p, plane.axis, centroids, extent) < plane.bin;
+        });
+
+    return static_cast<size_t>(middle - primitives.begin());
+  }
+
+  // partition() in three passes over chunks: count each chunk's left side,
+  // scatter every chunk to its place in scratch, copy back. Stable, unlike
+  // the serial one.
+  static size_t partition_parallel(thread_pool &pool,
+                                   std::vector<primitive> &primitives,
+                                   std::vector<primitive> &scratch,
+                                   const size_t begin, const size_t end,
+                                   const aabb<real> &centroids,
+                                   const split_plane &plane) {
+    const real extent =
+        centroids.max[plane.axis] - centroids.min[plane.axis];
+    const auto goes_left = [&](const primitive &p) {
+      return bin_of(p, plane.axis, centroids, extent) < plane.bin;
+    };
+
+    const size_t chunks = chunk_count(begin, end);
+    std::vector<size_t> left_counts(chunks);
+    for_each_chunk(pool, begin, end,
+                   [&](const size_t chunk, const size_t b, const size_t e) {
+                     for (size_t i = b; i < e; ++i)
+                       left_counts[chunk] += goes_left(primitives[i]) ? 1 : 0;
+                   });
+
+    // Where each chunk's left and right primitives start in scratch
+    std::vector<size_t> left_starts(chunks);
+    std::vector<size_t> right_starts(chunks);
+    size_t left_total = 0;
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+      left_starts[chunk] = begin + left_total;
+      left_total += left_counts[chunk];
+    }
+    size_t right_total = 0;
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+      const size_t chunk_size =
+          std::min(end, begin + (chunk + 1) * constants::BVH_PARALLEL_GRAIN) -
+          (begin + chunk * constants::BVH_PARALLEL_GRAIN);
+      right_starts[chunk] = begin + left_total + right_total;
+      right_total += chunk_size - left_counts[chunk];
+    }
+
+    for_each_chunk(pool, begin, end,
+                   [&](const size_t chunk, const size_t b, const size_t e) {
+                     size_t left = left_starts[chunk];
+                     size_t right = right_starts[chunk];
+                     for (size_t i = b; i < e; ++i)
+                       scratch[goes_left(primitives[i]) ? left++ : right++] =
+                           primitives[i];
+                   });
+
+    for_each_chunk(pool, begin, end,
+                   [&](size_t, const size_t b, const size_t e) {
+                     std::copy(scratch.begin() + static_cast<ptrdiff_t>(b),
+                               scratch.begin() + static_cast<ptrdiff_t>(e),
+                               primitives.begin() + static_cast<ptrdiff_t>(b));
+                   });
+
+    return begin + left_total;
+  }
+
+  // Halves [begin, end) along the longest centroid axis; returns the middle
+  static size_t split_median(std::vector<primitive> &primitives,
+                             const size_t begin, const size_t end,
+                             const aabb<real> &centroids) {
+    const size_t axis = centroids.longest_axis();
+    const size_t middle = begin + (end - begin) / 2;
+    std::nth_element(primitives.begin() + static_cast<ptrdiff_t>(begin),
+                     primitives.begin() + static_cast<ptrdiff_t>(middle),
+                     primitives.begin() + static_cast<ptrdiff_t>(end),
+                     [axis](const primitive &a, const primitive &b) {
+                       return a.centroid[axis] < b.centroid[axis];
+                     });
+    return middle;
+  }
+
+  static size_t bin_of(const primitive &p, const size_t axis,
+                       const aabb<real> &centroids, const real extent) {
+    constexpr size_t B = constants::BVH_BINS;
+
+    const auto b = static_cast<size_t>(
+        (p.centroid[axis] - centroids.min[axis]) * static_cast<real>(B) /
+        extent);
+    return b < B ? b : B - 1;
+  }
+};
+} // namespace rtm
+
+#endif
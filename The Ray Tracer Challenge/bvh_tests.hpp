@@ -0,0 +1,371 @@
+#ifndef BVH_TESTS_HPP
+#define BVH_TESTS_HPP
+
+#include "bvh.hpp"
+#include "compressed_bvh.hpp"
+#include "lighting.hpp"
+#include "shadow.hpp"
+#include "sphere.hpp"
+#include "test_helpers.hpp"
+#include "thread_pool.hpp"
+#include <random>
+#include <vector>
+
+namespace rtm::testing {
+namespace {
+// Seeded source of the spheres and rays the hierarchy tests share: spheres
+// scattered through a cube of half-width extent, stretched and turned about
+// y, and rays from anywhere in that cube in any direction
+class random_sphere_scene {
+public:
+  random_sphere_scene(const unsigned seed, const size_t count,
+                      const double extent = 20, const double min_size = 0.2,
+                      const double max_size = 1.5)
+      : m_engine{seed}, m_position{-extent, extent},
+        m_size{min_size, max_size} {
+    objects.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      auto s = rtm::sphere::make();
+      s->set_transform(
+          matrix_translate<real>({position(), position(), position()}) *
+          matrix_rotate_y<real>(static_cast<long double>(unit())) *
+          matrix_scale<real>({size(), size(), size()}));
+      objects.push_back(s);
+    }
+  }
+
+  std::vector<std::shared_ptr<object>> objects{};
+
+  real position() { return draw(m_position); }
+
+  real size() { return draw(m_size); }
+
+  real unit() { return draw(m_unit); }
+
+  rtm::ray<real> random_ray() {
+    const real x = position();
+    const real y = position();
+    const real z = position();
+    const real dx = unit();
+    const real dy = unit();
+    const real dz = unit();
+    return {{x, y, z, 1}, {dx, dy, dz, 0}};
+  }
+
+private:
+  std::mt19937 m_engine;
+  std::uniform_real_distribution<double> m_position;
+  std::uniform_real_distribution<double> m_size;
+  std::uniform_real_distribution<double> m_unit{-1, 1};
+
+  real draw(std::uniform_real_distribution<double> &distribution) {
+    return static_cast<real>(distribution(m_engine));
+  }
+};
+} // namespace
+
+inline void perform_bvh_tests() {
+  // World bounds follow the object's transform
+  {
+    auto s = rtm::sphere::make();
+    s->set_transform(matrix_translate<real>({5, 0, -2}) *
+                     matrix_scale<real>({2, 3, 4}));
+
+    const auto box = s->bounds();
+
+    expected(vec<3, real>{3, -3, -6}, box.min);
+    expected(vec<3, real>{7, 3, 2}, box.max);
+  }
+
+  // Empty hierarchy never hits
+  {
+    const bvh empty_bvh{{}};
+
+    expected(true, empty_bvh.empty());
+    expected(false, empty_bvh
+                        .closest_hit({{0, 0, -5, 1}, {0, 0, 1, 0}})
+                        .has_value());
+  }
+
+  // Closest hit through the hierarchy equals brute force over all objects
+  {
+    random_sphere_scene scene{1234, 300};
+    const auto &objects = scene.objects;
+
+    const bvh hierarchy{objects};
+
+    expected(objects.size(), hierarchy.objects().size());
+
+    size_t hits = 0;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < 2000; ++i) {
+      const rtm::ray<real> r = scene.random_ray();
+
+      const auto reference = closest_hit(objects, r);
+      const auto accelerated = hierarchy.closest_hit(r);
+
+      if (reference.has_value() != accelerated.has_value()) {
+        ++mismatches;
+      } else if (reference) {
+        ++hits;
+        if (reference->t != accelerated->t ||
+            reference->object != accelerated->object)
+          ++mismatches;
+      }
+    }
+
+    expected(true, hits > 0);
+    expected(size_t{0}, mismatches);
+
+    // Any-hit agrees with the closest hit about whether something is
+    // closer than a limit, and whatever it returns really is in the way
+    size_t blocked = 0;
+    mismatches = 0;
+    for (size_t i = 0; i < 2000; ++i) {
+      const rtm::ray<real> r = scene.random_ray();
+      const real t_max = scene.size() * 20;
+
+      const auto reference = closest_hit(objects, r);
+      const object *occluder = hierarchy.any_hit(r, t_max);
+
+      if ((reference && reference->t < t_max) != (occluder != nullptr))
+        ++mismatches;
+      if (occluder) {
+        ++blocked;
+        if (!occludes(*occluder, r, t_max))
+          ++mismatches;
+      }
+    }
+
+    expected(true, blocked > 0);
+    expected(size_t{0}, mismatches);
+
+    // Collecting every intersection finds the closest hit too, and the
+    // sorted list holds every root in order
+    intersection_list<> xs;
+    mismatches = 0;
+    for (size_t i = 0; i < 500; ++i) {
+      const rtm::ray<real> r = scene.random_ray();
+
+      xs.clear();
+      hierarchy.intersect_all(r, xs);
+
+      const auto reference = closest_hit(objects, r);
+      const auto nearest = xs.hit();
+      if (reference.has_value() != nearest.has_value() ||
+          (reference && (reference->t != nearest->t ||
+                         reference->object != nearest->object)))
+        ++mismatches;
+
+      const auto in_order = xs.sorted();
+      if (in_order.size() % 2 != 0 ||
+          !std::ranges::is_sorted(in_order, {}, &rtm::intersect::t))
+        ++mismatches;
+    }
+
+    expected(size_t{0}, mismatches);
+  }
+
+  // The compressed four-wide tree hits what its source tree hits, in a
+  // fraction of the memory
+  {
+    random_sphere_scene scene{4321, 500};
+    const auto &objects = scene.objects;
+
+    const bvh hierarchy{objects};
+    const compressed_bvh compressed{hierarchy};
+
+    expected(true, compressed.memory_bytes() * 2 <=
+                       hierarchy.nodes().size() * sizeof(bvh::node));
+
+    size_t hits = 0;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < 3000; ++i) {
+      // Every third ray starts inside an object
+      const auto inside = [&] {
+        const auto box = hierarchy.objects()[i % objects.size()]->bounds();
+        return box.centroid();
+      };
+      const auto start = i % 3 == 0 ? inside()
+                                    : vec<3, real>{scene.position(),
+                                                   scene.position(),
+                                                   scene.position()};
+      const rtm::ray<real> r{{start.x(), start.y(), start.z(), 1},
+                             {scene.unit(), scene.unit(), scene.unit(),
+                              0}};
+
+      const auto reference = hierarchy.closest_hit(r);
+      const auto h = compressed.closest_hit(r);
+
+      if (reference.has_value() != h.has_value()) {
+        ++mismatches;
+      } else if (reference) {
+        ++hits;
+        if (reference->t != h->t || reference->object != h->object)
+          ++mismatches;
+      }
+
+      const real t_max = scene.size() * 20;
+      const object *occluder = compressed.any_hit(r, t_max);
+      if ((reference && reference->t < t_max) != (occluder != nullptr))
+        ++mismatches;
+      if (occluder && !occludes(*occluder, r, t_max))
+        ++mismatches;
+    }
+
+    expected(true, hits > 0);
+    expected(size_t{0}, mismatches);
+
+    // Rays along the axes, which exercise the zero-direction slabs
+    mismatches = 0;
+    for (const auto &o : hierarchy.objects()) {
+      const auto c = o->bounds().centroid();
+      for (const vec4 direction : {vec4{1, 0, 0, 0}, vec4{0, -1, 0, 0},
+                                   vec4{0, 0, 1, 0}}) {
+        const rtm::ray<real> r{{c.x(), c.y(), c.z() - 30, 1}, direction};
+        const auto reference = hierarchy.closest_hit(r);
+        const auto h = compressed.closest_hit(r);
+        if (reference.has_value() != h.has_value() ||
+            (reference && reference->object != h->object))
+          ++mismatches;
+      }
+    }
+    expected(size_t{0}, mismatches);
+
+    // A lone object is a leaf under a single node; no objects, no nodes
+    const bvh single{{objects.front()}};
+    const compressed_bvh single_compressed{single};
+    expected(size_t{1}, single_compressed.nodes().size());
+    const auto c = objects.front()->bounds().centroid();
+    const rtm::ray<real> r{{c.x() - 40, c.y(), c.z(), 1}, {1, 0, 0, 0}};
+    expected(single.closest_hit(r)->t, single_compressed.closest_hit(r)->t);
+
+    const compressed_bvh none{bvh{{}}};
+    expected(true, none.empty());
+    expected(false, none.closest_hit({{0, 0, 0, 1}, {0, 0, 1, 0}}).has_value());
+    expected(true, none.any_hit({{0, 0, 0, 1}, {0, 0, 1, 0}}, 10) == nullptr);
+  }
+
+  // A parallel build big enough to split its top nodes across the pool
+  // answers like the serial one, to a tree of about the same cost
+  {
+    random_sphere_scene scene{77, 5 * constants::BVH_PARALLEL_GRAIN, 100, 0.1,
+                              1};
+    const auto &objects = scene.objects;
+
+    thread_pool pool{4};
+    const bvh serial{objects};
+    const bvh parallel{objects, pool};
+
+    const auto serial_stats = serial.stats();
+    const auto parallel_stats = parallel.stats();
+
+    size_t leaf_objects = 0;
+    size_t leaves = 0;
+    for (size_t n = 0; n < parallel_stats.leaf_sizes.size(); ++n) {
+      leaf_objects += n * parallel_stats.leaf_sizes[n];
+      leaves += parallel_stats.leaf_sizes[n];
+    }
+
+    expected(objects.size(), parallel.objects().size());
+    expected(objects.size(), leaf_objects);
+    expected(parallel_stats.leaf_count, leaves);
+    expected(2 * leaves - 1, parallel_stats.node_count);
+    expected(size_t{0}, parallel_stats.leaf_sizes[0]);
+    expected(true, parallel_stats.leaf_sizes.size() <=
+                       constants::BVH_MAX_LEAF_SIZE + 1);
+    expected(true, parallel_stats.depth > 1 &&
+                       parallel_stats.depth <= constants::BVH_STACK_SIZE);
+    expected(true,
+             c_abs(parallel_stats.sah_cost - serial_stats.sah_cost) <=
+                 serial_stats.sah_cost / 100);
+
+    size_t hits = 0;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < 2000; ++i) {
+      const rtm::ray<real> r = scene.random_ray();
+
+      const auto reference = serial.closest_hit(r);
+      const auto h = parallel.closest_hit(r);
+
+      if (reference.has_value() != h.has_value()) {
+        ++mismatches;
+      } else if (reference) {
+        ++hits;
+        if (reference->t != h->t || reference->object != h->object)
+          ++mismatches;
+      }
+    }
+
+    expected(true, hits > 0);
+    expected(size_t{0}, mismatches);
+  }
+
+  // Shadows in the book's default world
+  {
+    auto outer = rtm::sphere::make();
+    auto inner = rtm::sphere::make();
+    inner->set_transform(matrix_scale<real>({0.5L, 0.5L, 0.5L}));
+    const bvh world{{outer, inner}};
+    const point_light light{{1, 1, 1}, {-10, 10, -10, 1}};
+
+    // Nothing collinear with point and light
+    expected(false, is_shadowed(world, {0, 10, 0, 1}, light));
+    // The object is between the point and the light
+    expected(true, is_shadowed(world, {10, -10, 10, 1}, light));
+    // The object is behind the light
+    expected(false, is_shadowed(world, {-20, 20, -20, 1}, light));
+    // The object is behind the point
+    expected(false, is_shadowed(world, {-2, 2, -2, 1}, light));
+
+    // Points on a surface start their shadow ray just above it: the lit
+    // side does not shadow itself, the far side is still shadowed
+    const vec4 facing = normalize(vec4{-1, 1, -1, 0}) + vec4{0, 0, 0, 1};
+    expected(false, is_shadowed(world,
+                                over_point(facing, normal_at(*outer, facing)),
+                                light));
+    const vec4 away = normalize(vec4{1, -1, 1, 0}) + vec4{0, 0, 0, 1};
+    expected(true,
+             is_shadowed(world, over_point(away, normal_at(*outer, away)),
+                         light));
+
+    // Only the ambient term is left in shadow
+    expected(clr1{0.1, 0.1, 0.1},
+             lighting(material{}, point_light{{1, 1, 1}, {0, 0, -10, 1}},
+                      vec4{0, 0, 0, 1}, vec4{0, 0, -1, 0},
+                      normal{0, 0, -1, 0}, true));
+  }
+
+  // The last occluder is remembered per light and tried first
+  {
+    auto left = rtm::sphere::make();
+    auto right = rtm::sphere::make();
+    left->set_transform(matrix_translate<real>({-3, 0, 0}));
+    right->set_transform(matrix_translate<real>({3, 0, 0}));
+    const bvh world{{left, right}};
+    const point_light light{{1, 1, 1}, {0, 0, -10, 1}};
+
+    occluder_cache cache{1};
+    expected(true, cache[0] == nullptr);
+
+    // Behind the left sphere as seen from the light
+    expected(true, is_shadowed(world, {-3, 0, 5, 1}, light, cache[0]));
+    expected(true, cache[0] == left.get());
+
+    // A stale entry neither shadows a lit point nor gets dropped
+    expected(false, is_shadowed(world, {0, 0, 5, 1}, light, cache[0]));
+    expected(true, cache[0] == left.get());
+
+    // Nor does it hide another occluder
+    expected(true, is_shadowed(world, {3, 0, 5, 1}, light, cache[0]));
+    expected(true, cache[0] == right.get());
+
+    // Slots appear as lights are added
+    expected(true, cache[4] == nullptr);
+    cache.clear();
+    expected(true, cache[0] == nullptr);
+  }
+}
+} // namespace rtm::testing
+
+#endif
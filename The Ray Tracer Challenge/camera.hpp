@@ -1 +1,193 @@
+#ifndef CAMERA_HPP
+#define CAMERA_HPP
 
+#include "affine.hpp"
+#include "math_utils.hpp"
+#include "matrix.hpp"
+#include "ray.hpp"
+#include "ray_packet.hpp"
+#include "simd_pack.hpp"
+#include "tile.hpp"
+#include "vec.hpp"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace rtm {
+// World-to-eye transform for an eye at from looking at to; up only needs to
+// be roughly up
+template <typename V = void> struct ViewTransform {
+  template <std::floating_point T>
+  [[nodiscard]] constexpr matrix<4, 4, T> operator()(const vec<4, T> &from,
+                                                     const vec<4, T> &to,
+                                                     const vec<4, T> &up) {
+    const vec<4, T> forward = normalize(to - from);
+    const vec<4, T> left = cross_product(forward, vec<4, T>(normalize(up)));
+    const vec<4, T> true_up = cross_product(left, forward);
+
+    const matrix<4, 4, T> orientation{
+        left.x(),     left.y(),     left.z(),     0,
+        true_up.x(),  true_up.y(),  true_up.z(),  0,
+        -forward.x(), -forward.y(), -forward.z(), 0,
+        0,            0,            0,            1};
+
+    return orientation *
+           matrix_translate<T>({-from.x(), -from.y(), -from.z()});
+  }
+};
+
+template <std::floating_point T>
+[[nodiscard]] constexpr matrix<4, 4, T>
+view_transform(const vec<4, T> &from, const vec<4, T> &to,
+               const vec<4, T> &up) {
+  return ViewTransform{}(from, to, up);
+}
+
+// Pinhole camera one unit in front of its canvas. Everything a primary ray
+// needs is derived once per change of resolution, field of view or transform:
+// the eye in world space, the direction through the centre of pixel (0, 0)
+// and how that direction moves per column and per row. A ray is then two
+// multiply-adds and a normalization.
+class camera {
+public:
+  camera(const size_t width, const size_t height, const real field_of_view)
+      : m_width{width}, m_height{height}, m_field_of_view{field_of_view} {
+    update();
+  }
+
+  [[nodiscard]] size_t width() const noexcept { return m_width; }
+
+  [[nodiscard]] size_t height() const noexcept { return m_height; }
+
+  [[nodiscard]] real field_of_view() const noexcept { return m_field_of_view; }
+
+  [[nodiscard]] real pixel_size() const noexcept { return m_pixel_size; }
+
+  [[nodiscard]] const affine<real> &transform() const noexcept {
+    return m_transform;
+  }
+
+  [[nodiscard]] const affine<real> &inverse_transform() const noexcept {
+    return m_inverse_transform;
+  }
+
+  void set_resolution(const size_t width, const size_t height) {
+    m_width = width;
+    m_height = height;
+    update();
+  }
+
+  void set_field_of_view(const real field_of_view) {
+    m_field_of_view = field_of_view;
+    update();
+  }
+
+  void set_transform(const matrix<4, 4, real> &transform) {
+    set_transform(affine<real>{transform});
+  }
+
+  void set_transform(const affine<real> &transform) {
+    m_transform = transform;
+    m_inverse_transform = affine_inverse(transform);
+    update();
+  }
+
+  // Through the centre of pixel (row, col), row 0 at the top
+  [[nodiscard]] ray<real> ray_for_pixel(const size_t row,
+                                        const size_t col) const {
+    const auto direction = m_corner + m_column_step * static_cast<real>(col) +
+                           m_row_step * static_cast<real>(row);
+
+    return {m_origin, normalize(direction)};
+  }
+
+  // Pixels (row, col) to (row, col + W - 1), one per lane
+  template <size_t W>
+  [[nodiscard]] ray_packet<W, real> packet_for_pixels(const size_t row,
+                                                      const size_t col) const {
+    using pack_type = simd::pack<real, W>;
+
+    std::array<real, W> columns{};
+    for (size_t i = 0; i < W; ++i)
+      columns[i] = static_cast<real>(col + i);
+
+    const auto c = pack_type::load(columns.data());
+    const auto r = static_cast<real>(row);
+
+    const auto component = [&](const size_t axis) {
+      return pack_type::broadcast(m_corner[axis]) +
+             pack_type::broadcast(m_column_step[axis]) * c +
+             pack_type::broadcast(m_row_step[axis] * r);
+    };
+
+    const auto x = component(0);
+    const auto y = component(1);
+    const auto z = component(2);
+    const auto inverse_length = rsqrt(x * x + y * y + z * z);
+
+    return {pack_type::broadcast(m_origin.x()),
+            pack_type::broadcast(m_origin.y()),
+            pack_type::broadcast(m_origin.z()),
+            x * inverse_length,
+            y * inverse_length,
+            z * inverse_length};
+  }
+
+  // Calls f(packet, row, col, mask) for every run of up to W pixels of t,
+  // scanline by scanline. Lanes past the tile's last column still carry a
+  // ray (through pixels further along) but are clear in mask.
+  template <size_t W, typename F>
+  void for_each_packet(const tile &t, F &&f) const {
+    using mask_type = typename ray_packet<W, real>::mask_type;
+
+    for (size_t r = t.row_begin; r < t.row_end; ++r) {
+      for (size_t c = t.col_begin; c < t.col_end; c += W) {
+        const size_t count = std::min(W, t.col_end - c);
+        const mask_type mask = (mask_type{1} << count) - 1;
+
+        f(packet_for_pixels<W>(r, c), r, c, mask);
+      }
+    }
+  }
+
+private:
+  size_t m_width;
+  size_t m_height;
+  real m_field_of_view;
+  affine<real> m_transform{};
+  affine<real> m_inverse_transform{};
+
+  real m_pixel_size{};
+  vec4 m_origin{0, 0, 0, 1};
+  vec4 m_corner{};
+  vec4 m_column_step{};
+  vec4 m_row_step{};
+
+  void update() {
+    if (m_width == 0 || m_height == 0)
+      throw std::invalid_argument("Camera resolution must be non-zero");
+
+    const real half_view = c_tan(m_field_of_view / 2);
+    const real aspect =
+        static_cast<real>(m_width) / static_cast<real>(m_height);
+
+    const real half_width = aspect >= 1 ? half_view : half_view * aspect;
+    const real half_height = aspect >= 1 ? half_view / aspect : half_view;
+
+    m_pixel_size = half_width * 2 / static_cast<real>(m_width);
+
+    // The canvas is at z = -1 in camera space, +x to the left of the image
+    const real offset = m_pixel_size / 2;
+    m_origin = m_inverse_transform.transform_point({0, 0, 0, 1});
+    m_corner = m_inverse_transform.transform_point(
+                   {half_width - offset, half_height - offset, -1, 1}) -
+               m_origin;
+    m_column_step =
+        m_inverse_transform.transform_direction({-m_pixel_size, 0, 0, 0});
+    m_row_step =
+        m_inverse_transform.transform_direction({0, -m_pixel_size, 0, 0});
+  }
+};
+} // namespace rtm
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef CAMERA_TESTS_HPP
+#define CAMERA_TESTS_HPP
+
+#include "camera.hpp"
+#include "test_helpers.hpp"
+#include <vector>
+
+namespace rtm::testing {
+inline void perform_camera_tests() {
+  // View transforms
+  {
+    expected(identity_matrix<4, real>(),
+             view_transform<real>({0, 0, 0, 1}, {0, 0, -1, 1}, {0, 1, 0, 0}));
+
+    expected(matrix_scale<real>({-1, 1, -1}),
+             view_transform<real>({0, 0, 0, 1}, {0, 0, 1, 1}, {0, 1, 0, 0}));
+
+    expected(matrix_translate<real>({0, 0, -8}),
+             view_transform<real>({0, 0, 8, 1}, {0, 0, 0, 1}, {0, 1, 0, 0}));
+
+    expected(matrix<4, 4, real>{-0.5070925528371099L, 0.5070925528371099L,
+                                0.6761234037828132L, -2.366431913239846L,
+                                0.7677159338596801L, 0.6060915267313263L,
+                                0.12121830534626524L, -2.8284271247461894L,
+                                -0.35856858280031806L, 0.5976143046671968L,
+                                -0.7171371656006361L, 0, 0, 0, 0, 1},
+             view_transform<real>({1, 3, 2, 1}, {4, -2, 8, 1}, {1, 1, 0, 0}));
+  }
+
+  // Pixel size follows the longer side of the canvas
+  {
+    const auto quarter_turn = static_cast<real>(constants::HALF_PI);
+
+    expected(real{0.01L}, camera{200, 125, quarter_turn}.pixel_size());
+    expected(real{0.01L}, camera{125, 200, quarter_turn}.pixel_size());
+  }
+
+  // Rays through the canvas
+  {
+    camera c{201, 101, static_cast<real>(constants::HALF_PI)};
+
+    expected(ray<real>{{0, 0, 0, 1}, {0, 0, -1, 0}}, c.ray_for_pixel(50, 100));
+    expected(ray<real>{{0, 0, 0, 1},
+                       {0.6651864261194508L, 0.3325932130597254L,
+                        -0.6685123582500481L, 0}},
+             c.ray_for_pixel(0, 0));
+
+    c.set_transform(matrix_rotate_y<real>(constants::PI / 4) *
+                    matrix_translate<real>({0, -2, 5}));
+
+    expected(ray<real>{{0, 2, -5, 1},
+                       {c_sqrt(real{2}) / 2, 0, -c_sqrt(real{2}) / 2, 0}},
+             c.ray_for_pixel(50, 100));
+  }
+
+  // Packets match the scalar rays lane by lane and cover a tile exactly once
+  {
+    camera c{37, 23, static_cast<real>(constants::PI / 3)};
+    c.set_transform(view_transform<real>({1, 2, -6, 1}, {0, 0.5L, 0, 1},
+                                         {0, 1, 0, 0}));
+
+    const tile t{3, 5, 11, 18};
+    std::vector<int> visits(c.width() * c.height(), 0);
+    size_t mismatches = 0;
+
+    const auto check = [&]<size_t W>() {
+      std::ranges::fill(visits, 0);
+
+      c.for_each_packet<W>(t, [&](const ray_packet<W, real> &packet,
+                                  const size_t row, const size_t col,
+                                  const uint32_t mask) {
+        for (size_t i = 0; i < W; ++i) {
+          if (!((mask >> i) & 1U))
+            continue;
+
+          ++visits[row * c.width() + col + i];
+          if (packet.lane(i) != c.ray_for_pixel(row, col + i))
+            ++mismatches;
+        }
+      });
+
+      for (size_t r = 0; r < c.height(); ++r)
+        for (size_t col = 0; col < c.width(); ++col) {
+          const bool inside = r >= t.row_begin && r < t.row_end &&
+                              col >= t.col_begin && col < t.col_end;
+          if (visits[r * c.width() + col] != (inside ? 1 : 0))
+            ++mismatches;
+        }
+    };
+
+    check.template operator()<4>();
+    check.template operator()<8>();
+
+    expected(size_t{0}, mismatches);
+  }
+}
+} // namespace rtm::testing
+
+#endif
@@ -1,71 +1,115 @@
 #ifndef CANVAS_HPP
 #define CANVAS_HPP
+#include "ppm.hpp"
 #include "vec.hpp"
 #include <algorithm>
-#include <array>
-#include <vector>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
 
 namespace rtm {
-template <size_t W, size_t H> class canvas {
-  using buffer_color_type = uint8_t;
-  static constexpr std::string_view FILE_SIG{"P3"};
-  static constexpr std::string_view FILE_MAX_ALLOWED_COLOR_VALUE{"255"};
-
-  static constexpr size_t BUFFER_THRESHOLD{128ULL * 128ULL};
-  static constexpr size_t BUFFER_SIZE{W * H};
-
-  using buffer_data_type = vec<3, buffer_color_type>;
-
-  using buffer_type =
-      std::conditional_t<BUFFER_SIZE <= BUFFER_THRESHOLD,
-                         std::array<buffer_data_type, BUFFER_SIZE>,
-                         std::vector<buffer_data_type>>;
-
-  static constexpr auto buffer_initialize() {
-    if constexpr (std::is_same_v<buffer_type,
-                                 std::array<buffer_data_type, BUFFER_SIZE>>)
-      return buffer_type{};
-    if constexpr (std::is_same_v<buffer_type, std::vector<buffer_data_type>>)
-      return buffer_type(BUFFER_SIZE);
-  }
+// Scales a [0, 1] color of any precision to the 0-255 range the canvas
+// stores, clamping out-of-range components
+template <std::floating_point T>
+[[nodiscard]] constexpr clr255 to_clr255(const vec<3, T> &color) {
+  clr255 temporary;
 
-public:
-  canvas() = default;
-
-  ~canvas() {
-    std::ofstream file{"out.ppm"};
-    file << FILE_SIG << '\n';
-    file << W << ' ' << H << '\n';
-    file << FILE_MAX_ALLOWED_COLOR_VALUE << '\n';
-
-    for (size_t r = 0; r < H; ++r) {
-      for (size_t c = 0; c < W; ++c) {
-        const auto &pixel = (*this)(r, c);
-        // Cast to int to print the numerical value
-        file << static_cast<int>(pixel.r()) << ' '
-             << static_cast<int>(pixel.g()) << ' '
-             << static_cast<int>(pixel.b()) << ' ';
-      }
-      file << '\n';
+  for (size_t i = 0; i < 3; ++i)
+    temporary[i] = static_cast<uint8_t>(
+        std::clamp(color[i] * T{255}, T{0}, T{255}));
+
+  return temporary;
+}
+
+namespace constants {
+// Cache line; rows handed to different threads then rarely share one at the
+// start of the buffer
+inline constexpr size_t CANVAS_ALIGNMENT{64};
+} // namespace constants
+
+// Framebuffer sized at run time, pixels row-major in one aligned heap block
+class canvas {
+  using buffer_data_type = clr255;
+
+  struct aligned_delete {
+    void operator()(buffer_data_type *p) const noexcept {
+      ::operator delete[](p, std::align_val_t{constants::CANVAS_ALIGNMENT});
     }
-  }
+  };
+
+public:
+  canvas(const size_t width, const size_t height)
+      : m_width{width}, m_height{height}, m_canvas_buffer{allocate(width,
+                                                                   height)} {}
 
   canvas(const canvas &) = delete;
-  canvas(canvas &&) noexcept = delete;
-  constexpr canvas &operator=(const canvas &) = delete;
-  constexpr canvas &operator=(canvas &&) noexcept = delete;
+  canvas(canvas &&) noexcept = default;
+  canvas &operator=(const canvas &) = delete;
+  canvas &operator=(canvas &&) noexcept = default;
+
+  [[nodiscard]] size_t width() const noexcept { return m_width; }
+
+  [[nodiscard]] size_t height() const noexcept { return m_height; }
+
+  [[nodiscard]] const buffer_data_type *data() const noexcept {
+    return m_canvas_buffer.get();
+  }
 
-  [[nodiscard]] constexpr const buffer_data_type &operator()(size_t row,
-                                                             size_t col) const {
-    return m_canvas_buffer[row * W + col];
+  [[nodiscard]] buffer_data_type *data() noexcept {
+    return m_canvas_buffer.get();
   }
 
-  [[nodiscard]] constexpr buffer_data_type &operator()(size_t row, size_t col) {
-    return m_canvas_buffer[row * W + col];
+  [[nodiscard]] std::span<const buffer_data_type> row(const size_t r) const {
+    return {m_canvas_buffer.get() + r * m_width, m_width};
+  }
+
+  [[nodiscard]] const buffer_data_type &operator()(const size_t row,
+                                                   const size_t col) const {
+    return m_canvas_buffer[row * m_width + col];
+  }
+
+  [[nodiscard]] buffer_data_type &operator()(const size_t row,
+                                             const size_t col) {
+    return m_canvas_buffer[row * m_width + col];
+  }
+
+  // Writes the frame as PPM, binary P6 unless asked for P3; throws
+  // std::runtime_error if the file cannot be written
+  void save(const std::filesystem::path &path,
+            const ppm_format format = ppm_format::binary) const {
+    ppm_writer writer{path, m_width, m_height, format};
+
+    for (size_t r = 0; r < m_height; ++r)
+      writer.write_row(row(r));
+
+    writer.finish();
   }
 
 private:
-  buffer_type m_canvas_buffer{buffer_initialize()};
+  size_t m_width;
+  size_t m_height;
+  std::unique_ptr<buffer_data_type[], aligned_delete> m_canvas_buffer;
+
+  static std::unique_ptr<buffer_data_type[], aligned_delete>
+  allocate(const size_t width, const size_t height) {
+    if (width == 0 || height == 0)
+      throw std::invalid_argument("Canvas dimensions must be non-zero");
+    if (height > std::numeric_limits<size_t>::max() / sizeof(buffer_data_type) /
+                     width)
+      throw std::length_error("Canvas dimensions overflow the address space");
+
+    const size_t count = width * height;
+    auto *p = static_cast<buffer_data_type *>(
+        ::operator new[](count * sizeof(buffer_data_type),
+                         std::align_val_t{constants::CANVAS_ALIGNMENT}));
+    // Start out black
+    std::uninitialized_value_construct_n(p, count);
+
+    return std::unique_ptr<buffer_data_type[], aligned_delete>{p};
+  }
 };
 } // namespace rtm
 
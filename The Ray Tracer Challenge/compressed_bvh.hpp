@@ -0,0 +1,388 @@
+#ifndef COMPRESSED_BVH_HPP
+#define COMPRESSED_BVH_HPP
+
+#include "bounds.hpp"
+#include "bvh.hpp"
+#include "primitive.hpp"
+#include "scene_object.hpp"
+#include "simd_pack.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace rtm {
+namespace constants {
+inline constexpr size_t COMPRESSED_BVH_WIDTH{4};
+// Every node of the source tree has at most two children and the tree is at
+// most BVH_STACK_SIZE deep, so this many entries always suffice
+inline constexpr size_t COMPRESSED_BVH_STACK_SIZE{
+    (COMPRESSED_BVH_WIDTH - 1) * BVH_STACK_SIZE + 1};
+// Child boxes grow by this much of the largest coordinate of their parent
+// before they are quantized, which absorbs rounding a ray origin to float as
+// long as the origin is not orders of magnitude further out than the scene
+inline constexpr float COMPRESSED_BVH_MARGIN{1.0F / (1 << 20)};
+// Relative slack on the far end of every float slab interval, for the
+// rounding of the slab test itself
+inline constexpr float COMPRESSED_BVH_SLACK{1.0F / (1 << 20)};
+} // namespace constants
+
+// Four-wide BVH with one 64-byte node per four children. A node stores its
+// own box as a float origin and a power-of-two step per axis, and each
+// child's box as byte offsets on that grid, rounded outwards so that the
+// decoded box always contains the real one. Traversal decodes all four
+// children of a node and runs their slab tests together in float packs;
+// leaves test their objects at full precision, so the hits are those of the
+// source tree. Built from a bvh by pulling grandchildren up into each node.
+class compressed_bvh {
+public:
+  static constexpr size_t WIDTH{constants::COMPRESSED_BVH_WIDTH};
+
+  struct alignas(64) node {
+    std::array<float, 3> origin{};
+    std::array<int8_t, 3> exponent{}; // the grid step is 2^exponent
+    uint8_t child_count{};
+    // [axis][child], so one axis of every child is a single 4-byte load
+    std::array<std::array<uint8_t, WIDTH>, 3> lower{};
+    std::array<std::array<uint8_t, WIDTH>, 3> upper{};
+    std::array<uint32_t, WIDTH> child{}; // node index, or first object
+    std::array<uint8_t, WIDTH> leaf_size{}; // objects in a leaf, 0 for nodes
+  };
+
+  static_assert(sizeof(node) == 64);
+
+  compressed_bvh() = default;
+
+  // Throws std::length_error for a leaf of more than 255 objects and
+  // std::domain_error for unbounded objects
+  explicit compressed_bvh(const bvh &source) : m_objects{source.objects()} {
+    const auto &binary = source.nodes();
+    if (binary.empty())
+      return;
+
+    m_nodes.reserve(binary.size() / (WIDTH - 1) + 1);
+    convert(binary, 0);
+  }
+
+  [[nodiscard]] bool empty() const { return m_nodes.empty(); }
+
+  [[nodiscard]] const std::vector<node> &nodes() const { return m_nodes; }
+
+  [[nodiscard]] const std::vector<std::shared_ptr<object>> &objects() const {
+    return m_objects;
+  }
+
+  // Bytes taken by the nodes
+  [[nodiscard]] size_t memory_bytes() const {
+    return m_nodes.size() * sizeof(node);
+  }
+
+  // Nearest non-negative hit, same result as bvh::closest_hit()
+  [[nodiscard]] std::optional<rtm::intersect>
+  closest_hit(const ray<real> &r) const {
+    std::optional<rtm::intersect> closest;
+    if (m_nodes.empty())
+      return closest;
+
+    const float_ray fr{r};
+    real t_max = std::numeric_limits<real>::infinity();
+    float t_limit = widen(t_max);
+
+    std::array<entry, constants::COMPRESSED_BVH_STACK_SIZE> stack;
+    size_t top = 0;
+    stack[top++] = {0, 0, 0};
+
+    while (top > 0) {
+      const entry current = stack[--top];
+      // Something closer was found since this entry was pushed
+      if (current.t > t_limit)
+        continue;
+
+      if (current.leaf_size > 0) {
+        for (uint32_t i = current.index;
+             i < current.index + current.leaf_size; ++i) {
+          if (const auto xs = dispatch_intersect(*m_objects[i], r)) {
+            if (const auto h = hit(*xs); h && h->t < t_max) {
+              closest = h;
+              t_max = h->t;
+              t_limit = widen(t_max);
+            }
+          }
+        }
+        continue;
+      }
+
+      const node &n = m_nodes[current.index];
+      std::array<float, WIDTH> entries{};
+      const auto mask = intersect_children(n, fr, t_limit, entries);
+
+      // Far children first so the nearest is popped next
+      std::array<entry, WIDTH> hits;
+      size_t count = 0;
+      for (uint32_t c = 0; c < WIDTH; ++c) {
+        if (!((mask >> c) & 1U))
+          continue;
+
+        entry e{n.child[c], n.leaf_size[c], entries[c]};
+        size_t slot = count++;
+        for (; slot > 0 && hits[slot - 1].t < e.t; --slot)
+          hits[slot] = hits[slot - 1];
+        hits[slot] = e;
+      }
+
+      for (size_t i = 0; i < count; ++i)
+        stack[top++] = hits[i];
+    }
+
+    return closest;
+  }
+
+  // Some object hit at a t in [0, t_max), or nullptr; see bvh::any_hit()
+  [[nodiscard]] const object *any_hit(const ray<real> &r,
+                                      const real t_max) const {
+    if (m_nodes.empty())
+      return nullptr;
+
+    const float_ray fr{r};
+    const float t_limit = widen(t_max);
+
+    std::array<entry, constants::COMPRESSED_BVH_STACK_SIZE> stack;
+    size_t top = 0;
+    stack[top++] = {0, 0, 0};
+
+    while (top > 0) {
+      const entry current = stack[--top];
+
+      if (current.leaf_size > 0) {
+        for (uint32_t i = current.index;
+             i < current.index + current.leaf_size; ++i)
+          if (occludes(*m_objects[i], r, t_max))
+            return m_objects[i].get();
+        continue;
+      }
+
+      const node &n = m_nodes[current.index];
+      std::array<float, WIDTH> entries{};
+      const auto mask = intersect_children(n, fr, t_limit, entries);
+
+      for (uint32_t c = 0; c < WIDTH; ++c)
+        if ((mask >> c) & 1U)
+          stack[top++] = {n.child[c], n.leaf_size[c], entries[c]};
+    }
+
+    return nullptr;
+  }
+
+private:
+  using pack_type = simd::pack<float, WIDTH>;
+
+  struct entry {
+    uint32_t index;
+    uint32_t leaf_size; // 0 for a node
+    float t;
+  };
+
+  // The ray in float, with what the slab tests need per axis
+  struct float_ray {
+    std::array<float, 3> origin;
+    std::array<float, 3> inverse_direction;
+    // Whether the ray enters through the upper plane of the axis
+    std::array<bool, 3> negative;
+
+    explicit float_ray(const ray<real> &r) {
+      for (size_t axis = 0; axis < 3; ++axis) {
+        origin[axis] = static_cast<float>(r.origin[axis]);
+        inverse_direction[axis] = 1.0F / static_cast<float>(r.direction[axis]);
+        negative[axis] = std::signbit(inverse_direction[axis]);
+      }
+    }
+  };
+
+  std::vector<node> m_nodes{};
+  std::vector<std::shared_ptr<object>> m_objects{};
+
+  [[nodiscard]] static float widen(const real t) {
+    const auto f = static_cast<float>(t);
+    return f * (1 + constants::COMPRESSED_BVH_SLACK);
+  }
+
+  [[nodiscard]] static float step(const int8_t exponent) {
+    return std::ldexp(1.0F, exponent);
+  }
+
+  // The decoded bound of q on an axis; the builder and traversal must agree
+  // on this to the bit
+  [[nodiscard]] static float decode(const float origin, const float scale,
+                                    const uint8_t q) {
+    return origin + static_cast<float>(q) * scale;
+  }
+
+  [[nodiscard]] static pack_type
+  decode(const float origin, const float scale,
+         const std::array<uint8_t, WIDTH> &q) {
+    std::array<float, WIDTH> values{};
+    for (size_t c = 0; c < WIDTH; ++c)
+      values[c] = static_cast<float>(q[c]);
+
+    return pack_type::broadcast(origin) +
+           pack_type::load(values.data()) * pack_type::broadcast(scale);
+  }
+
+  // Slab test of all children of n at once over [0, t_limit]: bit c of the
+  // result is set if child c is hit, entries[c] is where
+  static pack_type::mask_type
+  intersect_children(const node &n, const float_ray &r, const float t_limit,
+                     std::array<float, WIDTH> &entries) {
+    auto t_entry = pack_type::broadcast(0);
+    auto t_exit = pack_type::broadcast(t_limit);
+
+    for (size_t axis = 0; axis < 3; ++axis) {
+      const float scale = step(n.exponent[axis]);
+      const auto &near = r.negative[axis] ? n.upper[axis] : n.lower[axis];
+      const auto &far = r.negative[axis] ? n.lower[axis] : n.upper[axis];
+
+      const auto origin = pack_type::broadcast(r.origin[axis]);
+      const auto inverse = pack_type::broadcast(r.inverse_direction[axis]);
+      const auto t_near =
+          (decode(n.origin[axis], scale, near) - origin) * inverse;
+      const auto t_far =
+          (decode(n.origin[axis], scale, far) - origin) * inverse;
+
+      // Operands ordered so that a NaN (origin on a slab plane, zero
+      // direction) leaves the interval as it is
+      t_entry = max(t_near, t_entry);
+      t_exit = min(t_far, t_exit);
+    }
+
+    t_entry.store(entries.data());
+
+    const auto widened =
+        t_exit * pack_type::broadcast(1 + constants::COMPRESSED_BVH_SLACK);
+    const pack_type::mask_type valid =
+        (pack_type::mask_type{1} << n.child_count) - 1;
+    return (t_entry <= widened) & valid;
+  }
+
+  // Appends the wide node for binary node index and, depth first, the
+  // nodes under it; returns its index
+  uint32_t convert(const std::vector<bvh::node> &binary, const uint32_t index) {
+    const auto node_index = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.emplace_back();
+
+    // A leaf at the root still gets a node above it
+    std::array<uint32_t, WIDTH> children{index};
+    size_t count = 1;
+
+    // Open up the largest interior child until the node is full
+    while (count < WIDTH) {
+      size_t widest = WIDTH;
+      real widest_area = -1;
+      for (size_t c = 0; c < count; ++c) {
+        const auto &candidate = binary[children[c]];
+        const real area = candidate.bounds.surface_area();
+        if (candidate.count == 0 && area > widest_area) {
+          widest = c;
+          widest_area = area;
+        }
+      }
+      if (widest == WIDTH)
+        break;
+
+      const uint32_t opened = children[widest];
+      children[widest] = opened + 1;
+      children[count++] = binary[opened].offset;
+    }
+
+    quantize(binary, node_index, children, count);
+
+    for (size_t c = 0; c < count; ++c) {
+      const auto &child = binary[children[c]];
+      if (child.count > 0) {
+        if (child.count > std::numeric_limits<uint8_t>::max())
+          throw std::length_error("compressed_bvh: leaf too large");
+        m_nodes[node_index].child[c] = child.offset;
+        m_nodes[node_index].leaf_size[c] = static_cast<uint8_t>(child.count);
+      } else {
+        const uint32_t converted = convert(binary, children[c]);
+        m_nodes[node_index].child[c] = converted;
+      }
+    }
+
+    return node_index;
+  }
+
+  // Fills in the grid of node_index and its children's byte boxes
+  void quantize(const std::vector<bvh::node> &binary, const uint32_t node_index,
+                const std::array<uint32_t, WIDTH> &children,
+                const size_t count) {
+    aabb<real> box;
+    for (size_t c = 0; c < count; ++c)
+      box.extend(binary[children[c]].bounds);
+
+    real magnitude = 0;
+    for (size_t axis = 0; axis < 3; ++axis) {
+      if (!std::isfinite(box.min[axis]) || !std::isfinite(box.max[axis]))
+        throw std::domain_error("compressed_bvh: bounds must be finite");
+      magnitude = std::max(
+          {magnitude, c_abs(box.min[axis]), c_abs(box.max[axis])});
+    }
+    const real margin = magnitude * constants::COMPRESSED_BVH_MARGIN;
+
+    node &n = m_nodes[node_index];
+    n.child_count = static_cast<uint8_t>(count);
+
+    for (size_t axis = 0; axis < 3; ++axis) {
+      const real low = box.min[axis] - margin;
+      const real high = box.max[axis] + margin;
+
+      // Origin rounded down, step just large enough for 255 to reach high
+      float origin = static_cast<float>(low);
+      if (origin > low)
+        origin = std::nextafter(origin,
+                                -std::numeric_limits<float>::infinity());
+
+      const real extent = high - origin;
+      int exponent = extent > 0
+                         ? static_cast<int>(std::ceil(std::log2(extent / 255)))
+                         : std::numeric_limits<int8_t>::min() / 2;
+      exponent = std::max(exponent, std::numeric_limits<int8_t>::min() / 2);
+      while (decode(origin, std::ldexp(1.0F, exponent), 255) < high)
+        ++exponent;
+      if (exponent > std::numeric_limits<int8_t>::max())
+        throw std::domain_error("compressed_bvh: bounds out of range");
+
+      n.origin[axis] = origin;
+      n.exponent[axis] = static_cast<int8_t>(exponent);
+      const float scale = step(n.exponent[axis]);
+
+      for (size_t c = 0; c < count; ++c) {
+        const auto &child = binary[children[c]].bounds;
+        const real child_low = child.min[axis] - margin;
+        const real child_high = child.max[axis] + margin;
+
+        const auto clamp_byte = [](const real q) {
+          return static_cast<uint8_t>(std::clamp<real>(q, 0, 255));
+        };
+        uint8_t lower = clamp_byte(std::floor((child_low - origin) / scale));
+        uint8_t upper = clamp_byte(std::ceil((child_high - origin) / scale));
+
+        // Round outwards for good, whatever the division did
+        while (lower > 0 && decode(origin, scale, lower) > child_low)
+          --lower;
+        while (upper < 255 && decode(origin, scale, upper) < child_high)
+          ++upper;
+
+        n.lower[axis][c] = lower;
+        n.upper[axis][c] = upper;
+      }
+    }
+  }
+};
+} // namespace rtm
+
+#endif
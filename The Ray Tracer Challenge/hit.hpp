@@ -26,6 +26,30 @@ constexpr std::optional<rtm::intersect> hit(const rtm::intersects &inters) {
   return closest_hit;
 }
 
+// Packet counterpart of hit(): per lane the closest non-negative root, mask
+// bit set where there is one
+template <size_t W, typename T = real> struct packet_hit {
+  using pack_type = simd::pack<T, W>;
+
+  pack_type t{};
+  typename pack_type::mask_type mask{};
+  const rtm::object *object{};
+};
+
+template <size_t W, typename T>
+packet_hit<W, T> hit(const rtm::packet_intersects<W, T> &inters) {
+  using pack_type = simd::pack<T, W>;
+
+  const auto zero = pack_type::broadcast(T{});
+
+  // t1 <= t2, so the near root wins whenever it is in front of the ray
+  const auto near_hits = inters.mask & (inters.t1 >= zero);
+  const auto far_hits = inters.mask & (inters.t2 >= zero);
+
+  return {select(near_hits, inters.t1, inters.t2), near_hits | far_hits,
+          inters.object};
+}
+
 } // namespace rtm
 
 #endif
@@ -1,21 +1,35 @@
 #ifndef INTERSECTION_HPP
 #define INTERSECTION_HPP
 
+#include "ray_packet.hpp"
 #include "scene_object.hpp"
 #include <array>
-#include <memory>
 
 namespace rtm {
 class object;
 
+// The object is a plain handle: the scene owns its objects and outlives every
+// hit record, so recording a hit costs no refcount traffic. weak_handle()
+// recovers shared ownership where that is wanted.
 struct intersect {
-  long double t{};
-  // vec<4, long double> point;
-  std::weak_ptr<object> object{};
-  // vec<4, long double> normal;
+  real t{};
+  // vec<4, real> point;
+  const rtm::object *object{};
+  // vec<4, real> normal;
 };
 
 using intersects = std::array<intersect, 2>;
+
+// Both roots of W rays against one object; lanes whose bit is clear in mask
+// missed and carry unspecified t values
+template <size_t W, typename T = real> struct packet_intersects {
+  using pack_type = simd::pack<T, W>;
+
+  pack_type t1{};
+  pack_type t2{};
+  typename pack_type::mask_type mask{};
+  const rtm::object *object{};
+};
 } // namespace rtm
 
 #endif
@@ -0,0 +1,142 @@
+#ifndef INTERSECTION_LIST_HPP
+#define INTERSECTION_LIST_HPP
+
+#include "intersect.hpp"
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace rtm {
+namespace constants {
+// Intersections held without touching the heap: a ray through a handful of
+// overlapping closed objects
+inline constexpr size_t INTERSECTION_INLINE_CAPACITY{8};
+} // namespace constants
+
+// Every intersection along one ray, for when the nearest is not enough (the
+// objects a refracted ray is inside of, say). Up to N records live in the
+// list itself; past that they move to a heap buffer that clear() keeps, so a
+// list reused ray after ray stops allocating once it has seen the worst case.
+// The nearest non-negative t is tracked as records come in, and the records
+// are only sorted when sorted() is asked for. Hit is anything with a t.
+template <typename Hit = intersect,
+          size_t N = constants::INTERSECTION_INLINE_CAPACITY>
+class intersection_list {
+public:
+  using value_type = Hit;
+
+  intersection_list() = default;
+
+  [[nodiscard]] size_t size() const noexcept { return m_size; }
+
+  [[nodiscard]] bool empty() const noexcept { return m_size == 0; }
+
+  // Whether the records outgrew the inline storage since the last clear()
+  [[nodiscard]] bool spilled() const noexcept { return m_spilled; }
+
+  void clear() noexcept {
+    m_size = 0;
+    m_nearest = NONE;
+    m_sorted = true;
+    m_spilled = false;
+    m_overflow.clear();
+  }
+
+  void push_back(const Hit &record) {
+    if (!m_spilled && m_size == N) {
+      m_overflow.assign(m_inline.begin(), m_inline.end());
+      m_spilled = true;
+    }
+
+    if (m_spilled)
+      m_overflow.push_back(record);
+    else
+      m_inline[m_size] = record;
+
+    if (m_size > 0 && record.t < data()[m_size - 1].t)
+      m_sorted = false;
+    if (record.t >= 0 && (m_nearest == NONE || record.t < data()[m_nearest].t))
+      m_nearest = m_size;
+
+    ++m_size;
+  }
+
+  void append(std::span<const Hit> records) {
+    for (const auto &record : records)
+      push_back(record);
+  }
+
+  // Nearest record at t >= 0, found without a scan
+  [[nodiscard]] std::optional<Hit> hit() const {
+    if (m_nearest == NONE)
+      return std::nullopt;
+    return data()[m_nearest];
+  }
+
+  // t of hit(), infinity without one; a closest-hit traversal can prune
+  // against it
+  [[nodiscard]] real nearest_t() const noexcept {
+    return m_nearest == NONE ? std::numeric_limits<real>::infinity()
+                             : data()[m_nearest].t;
+  }
+
+  // In the order they were added, or by t after sorted()
+  [[nodiscard]] std::span<const Hit> records() const noexcept {
+    return {data(), m_size};
+  }
+
+  // By increasing t; sorts in place, and only the first call after a change
+  // does any work
+  [[nodiscard]] std::span<const Hit> sorted() {
+    if (!m_sorted) {
+      std::sort(data(), data() + m_size,
+                [](const Hit &a, const Hit &b) { return a.t < b.t; });
+      m_sorted = true;
+
+      const auto first = std::find_if(data(), data() + m_size,
+                                      [](const Hit &h) { return h.t >= 0; });
+      m_nearest = first == data() + m_size
+                      ? NONE
+                      : static_cast<size_t>(first - data());
+    }
+
+    return records();
+  }
+
+  [[nodiscard]] const Hit &operator[](const size_t i) const {
+    return data()[i];
+  }
+
+  [[nodiscard]] const Hit *begin() const noexcept { return data(); }
+
+  [[nodiscard]] const Hit *end() const noexcept { return data() + m_size; }
+
+private:
+  static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+  std::array<Hit, N> m_inline{};
+  std::vector<Hit> m_overflow{};
+  size_t m_size{};
+  size_t m_nearest{NONE};
+  bool m_sorted{true};
+  bool m_spilled{false};
+
+  [[nodiscard]] Hit *data() noexcept {
+    return m_spilled ? m_overflow.data() : m_inline.data();
+  }
+
+  [[nodiscard]] const Hit *data() const noexcept {
+    return m_spilled ? m_overflow.data() : m_inline.data();
+  }
+};
+
+template <typename Hit, size_t N>
+[[nodiscard]] std::optional<Hit> hit(const intersection_list<Hit, N> &list) {
+  return list.hit();
+}
+} // namespace rtm
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef LIGHT_GRID_HPP
+#define LIGHT_GRID_HPP
+
+#include "bounds.hpp"
+#include "light_set.hpp"
+#include "vec.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace rtm {
+namespace constants {
+// Upper bound on grid cells; the cell size grows to stay under it
+inline constexpr size_t LIGHT_GRID_MAX_CELLS{1ULL << 18};
+} // namespace constants
+
+// Uniform grid over the spheres of influence of a light_set's lights. Every
+// cell lists the lights whose sphere reaches into it; the lights with an
+// infinite range reach everywhere and are kept once, beside the cells, rather
+// than in each of them. Lights with a zero range are left out altogether. A
+// shading point then only evaluates the lights of its cell. The grid lives in
+// world space, so it serves primary and secondary rays alike.
+class light_grid {
+public:
+  // cell_size 0 picks the mean influence diameter of the bounded lights
+  explicit light_grid(const light_set &lights, real cell_size = 0) {
+    if (cell_size < 0)
+      throw std::invalid_argument("light_grid: negative cell size");
+
+    std::vector<uint32_t> bounded;
+    real diameter_sum{};
+    for (size_t i = 0; i < lights.size(); ++i) {
+      const real range = lights.range()[i];
+      if (range == std::numeric_limits<real>::infinity()) {
+        m_everywhere.push_back(static_cast<uint32_t>(i));
+      } else if (range > 0) {
+        bounded.push_back(static_cast<uint32_t>(i));
+        diameter_sum += 2 * range;
+
+        const vec<3, real> center{lights.position(0)[i],
+                                  lights.position(1)[i],
+                                  lights.position(2)[i]};
+        const vec<3, real> reach{range, range, range};
+        m_bounds.extend(center - reach).extend(center + reach);
+      }
+    }
+
+    if (bounded.empty()) {
+      m_offsets = {0, 0};
+      return;
+    }
+
+    if (cell_size == 0)
+      cell_size = diameter_sum / static_cast<real>(bounded.size());
+    size_cells(cell_size);
+    fill(lights, bounded);
+  }
+
+  // Indices into the light_set, for the lighting() overload that takes them
+  [[nodiscard]] light_indices lights_near(const vec4 &point) const {
+    const size_t cell = cell_of(point);
+    return {m_everywhere, std::span{m_indices}.subspan(
+                              m_offsets[cell],
+                              m_offsets[cell + 1] - m_offsets[cell])};
+  }
+
+  [[nodiscard]] const aabb<real> &bounds() const noexcept { return m_bounds; }
+
+  [[nodiscard]] real cell_size() const noexcept { return m_cell_size; }
+
+  [[nodiscard]] const std::array<size_t, 3> &dimensions() const noexcept {
+    return m_dimensions;
+  }
+
+private:
+  aabb<real> m_bounds{};
+  real m_cell_size{};
+  std::array<size_t, 3> m_dimensions{0, 0, 0};
+  std::vector<uint32_t> m_everywhere{};
+  // Cell c's bounded lights are m_indices[m_offsets[c], m_offsets[c + 1]);
+  // the last cell is everything outside the grid and lists none
+  std::vector<size_t> m_offsets{};
+  std::vector<uint32_t> m_indices{};
+
+  [[nodiscard]] size_t cell_count() const noexcept {
+    return m_dimensions[0] * m_dimensions[1] * m_dimensions[2];
+  }
+
+  void size_cells(const real cell_size) {
+    const auto extent = m_bounds.extent();
+
+    m_cell_size = cell_size;
+    for (;;) {
+      real cells = 1;
+      for (size_t a = 0; a < 3; ++a)
+        cells *= std::max(real{1}, std::ceil(extent[a] / m_cell_size));
+      if (cells <= static_cast<real>(constants::LIGHT_GRID_MAX_CELLS))
+        break;
+      m_cell_size *= std::cbrt(cells / constants::LIGHT_GRID_MAX_CELLS);
+      // Rounding up per axis may still leave a few too many
+      m_cell_size *= real{1.01L};
+    }
+
+    for (size_t a = 0; a < 3; ++a)
+      m_dimensions[a] = static_cast<size_t>(
+          std::max(real{1}, std::ceil(extent[a] / m_cell_size)));
+  }
+
+  [[nodiscard]] size_t axis_cell(const real coordinate, const size_t a) const {
+    const real offset = (coordinate - m_bounds.min[a]) / m_cell_size;
+    return std::min(static_cast<size_t>(std::max(offset, real{})),
+                    m_dimensions[a] - 1);
+  }
+
+  [[nodiscard]] size_t cell_of(const vec4 &point) const {
+    if (m_dimensions[0] == 0)
+      return 0;
+
+    for (size_t a = 0; a < 3; ++a)
+      if (!(point[a] >= m_bounds.min[a] && point[a] <= m_bounds.max[a]))
+        return cell_count();
+
+    return (axis_cell(point[2], 2) * m_dimensions[1] +
+            axis_cell(point[1], 1)) *
+               m_dimensions[0] +
+           axis_cell(point[0], 0);
+  }
+
+  // Calls f(cell) for every cell the light's sphere of influence touches
+  template <typename F>
+  void for_each_cell(const light_set &lights, const uint32_t light,
+                     F &&f) const {
+    const real range = lights.range()[light];
+    std::array<real, 3> center{};
+    std::array<size_t, 3> first{}, last{};
+    for (size_t a = 0; a < 3; ++a) {
+      center[a] = lights.position(a)[light];
+      first[a] = axis_cell(center[a] - range, a);
+      last[a] = axis_cell(center[a] + range, a);
+    }
+
+    for (size_t z = first[2]; z <= last[2]; ++z)
+      for (size_t y = first[1]; y <= last[1]; ++y)
+        for (size_t x = first[0]; x <= last[0]; ++x) {
+          // Squared distance from the centre to the cell's box
+          const std::array<size_t, 3> cell{x, y, z};
+          real distance_squared{};
+          for (size_t a = 0; a < 3; ++a) {
+            const real low =
+                m_bounds.min[a] + static_cast<real>(cell[a]) * m_cell_size;
+            const real high = low + m_cell_size;
+            const real d = center[a] < low    ? low - center[a]
+                           : center[a] > high ? center[a] - high
+                                              : real{};
+            distance_squared += d * d;
+          }
+
+          if (distance_squared <= range * range)
+            f((z * m_dimensions[1] + y) * m_dimensions[0] + x);
+        }
+  }
+
+  void fill(const light_set &lights, std::span<const uint32_t> bounded) {
+    const size_t cells = cell_count();
+
+    // Counting pass, then each cell's run of m_indices is written in place
+    std::vector<size_t> counts(cells + 1, 0);
+    for (const auto light : bounded)
+      for_each_cell(lights, light, [&](const size_t cell) { ++counts[cell]; });
+
+    m_offsets.assign(cells + 2, 0);
+    for (size_t c = 0; c <= cells; ++c)
+      m_offsets[c + 1] = m_offsets[c] + counts[c];
+
+    m_indices.resize(m_offsets[cells + 1]);
+    std::vector<size_t> cursor(m_offsets.begin(), m_offsets.end() - 1);
+
+    for (const auto light : bounded)
+      for_each_cell(lights, light, [&](const size_t cell) {
+        m_indices[cursor[cell]++] = light;
+      });
+  }
+};
+} // namespace rtm
+
+#endif
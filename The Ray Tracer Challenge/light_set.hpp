@@ -0,0 +1,310 @@
+#ifndef LIGHT_SET_HPP
+#define LIGHT_SET_HPP
+
+#include "lighting.hpp"
+#include "material.hpp"
+#include "simd_math.hpp"
+#include "simd_pack.hpp"
+#include "vec.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace rtm {
+namespace constants {
+// Lights shaded per step of the multi-light kernel
+inline constexpr size_t LIGHT_PACK_WIDTH{simd::batch_width_v<real>};
+} // namespace constants
+
+// Point lights as structure of arrays, one array per coordinate and one per
+// colour channel. The arrays are padded with black lights to a whole number
+// of packs so the shading kernel loads full packs all the way through.
+class light_set {
+public:
+  light_set() = default;
+
+  explicit light_set(std::span<const point_light> lights) {
+    for (const auto &light : lights)
+      add(light);
+  }
+
+  void add(const point_light &light) {
+    if (m_size == padded_size())
+      grow(m_size + constants::LIGHT_PACK_WIDTH);
+
+    for (size_t i = 0; i < 3; ++i) {
+      m_position[i][m_size] = light.position[i];
+      m_intensity[i][m_size] = light.intensity[i];
+    }
+    m_range[m_size] = light.range;
+    ++m_size;
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return m_size; }
+
+  [[nodiscard]] bool empty() const noexcept { return m_size == 0; }
+
+  [[nodiscard]] point_light operator[](const size_t i) const {
+    if (i >= m_size)
+      throw std::out_of_range("light_set: index out of range");
+
+    return {{m_intensity[0][i], m_intensity[1][i], m_intensity[2][i]},
+            {m_position[0][i], m_position[1][i], m_position[2][i], 1},
+            m_range[i]};
+  }
+
+  // Padding included
+  [[nodiscard]] std::span<const real> position(const size_t axis) const {
+    return m_position.at(axis);
+  }
+
+  [[nodiscard]] std::span<const real> intensity(const size_t channel) const {
+    return m_intensity.at(channel);
+  }
+
+  [[nodiscard]] std::span<const real> range() const { return m_range; }
+
+private:
+  size_t m_size{};
+  std::array<std::vector<real>, 3> m_position{};
+  std::array<std::vector<real>, 3> m_intensity{};
+  std::vector<real> m_range{};
+
+  [[nodiscard]] size_t padded_size() const noexcept { return m_range.size(); }
+
+  void grow(const size_t padded) {
+    for (auto *components : {&m_position, &m_intensity})
+      for (auto &component : *components)
+        component.resize(padded, real{});
+    m_range.resize(padded, real{});
+  }
+};
+
+// baked_lighting for a whole light set, in the set's padded layout. The
+// ambient terms of all lights are summed up front so shading adds them once.
+struct baked_light_set {
+  clr1 ambient;
+  size_t size;
+  std::array<std::vector<real>, 3> position;
+  std::array<std::vector<real>, 3> diffuse;
+  std::array<std::vector<real>, 3> specular;
+  std::vector<real> inverse_range_squared;
+  fixed_power<real> shininess;
+};
+
+// A subset of a light_set's lights as two runs of indices: the lights
+// everywhere applies to, shared by every query, and the ones picked for
+// this query alone. light_grid::lights_near() hands these out.
+struct light_indices {
+  std::span<const uint32_t> everywhere{};
+  std::span<const uint32_t> local{};
+
+  [[nodiscard]] size_t size() const noexcept {
+    return everywhere.size() + local.size();
+  }
+
+  // The i-th index, counting through everywhere and then local
+  [[nodiscard]] uint32_t operator[](const size_t i) const noexcept {
+    return i < everywhere.size() ? everywhere[i]
+                                 : local[i - everywhere.size()];
+  }
+};
+
+[[nodiscard]] inline baked_light_set bake_lighting(const material &mat,
+                                                   const light_set &lights) {
+  baked_light_set baked{.ambient = {0, 0, 0},
+                        .size = lights.size(),
+                        .position = {},
+                        .diffuse = {},
+                        .specular = {},
+                        .inverse_range_squared = {},
+                        .shininess = fixed_power<real>{mat.shininess}};
+
+  for (size_t c = 0; c < 3; ++c) {
+    const auto position = lights.position(c);
+    const auto intensity = lights.intensity(c);
+
+    baked.position[c].assign(position.begin(), position.end());
+    baked.diffuse[c].resize(intensity.size());
+    baked.specular[c].resize(intensity.size());
+
+    real total_intensity{};
+    for (size_t i = 0; i < intensity.size(); ++i) {
+      baked.diffuse[c][i] = mat.color[c] * intensity[i] * mat.diffuse;
+      baked.specular[c][i] = intensity[i] * mat.specular;
+      total_intensity += intensity[i];
+    }
+    baked.ambient[c] = mat.color[c] * total_intensity * mat.ambient;
+  }
+
+  const auto range = lights.range();
+  baked.inverse_range_squared.resize(range.size());
+  for (size_t i = 0; i < range.size(); ++i)
+    baked.inverse_range_squared[i] = 1 / (range[i] * range[i]);
+
+  return baked;
+}
+
+namespace detail {
+// LIGHT_PACK_WIDTH lights of a baked_light_set, one pack per component
+struct light_pack {
+  using pack_type = simd::pack<real, constants::LIGHT_PACK_WIDTH>;
+
+  std::array<pack_type, 3> position;
+  std::array<pack_type, 3> diffuse;
+  std::array<pack_type, 3> specular;
+  pack_type inverse_range_squared;
+};
+
+// Diffuse plus specular over count lights, which fetch(i, lights) loads a
+// pack at a time starting from light i. Lanes at and past count are never
+// read, whatever fetch puts in them.
+template <typename Fetch>
+[[nodiscard]] clr1 shade_light_packs(const size_t count, Fetch &&fetch,
+                                     const fixed_power<real> &shininess,
+                                     const vec4 &point, const vec4 &eye_normal,
+                                     const normal &n) {
+  constexpr size_t width{constants::LIGHT_PACK_WIDTH};
+  using pack_type = light_pack::pack_type;
+
+  const auto zero = pack_type::broadcast(0);
+  const auto one = pack_type::broadcast(1);
+  const auto two = pack_type::broadcast(2);
+  const auto n_dot_eye = pack_type::broadcast(dot_product(n, eye_normal));
+
+  std::array<pack_type, 3> diffuse{zero, zero, zero};
+  std::array<pack_type, 3> specular{zero, zero, zero};
+  light_pack lights;
+
+  for (size_t i = 0; i < count; i += width) {
+    const auto valid = count - i >= width
+                           ? pack_type::ALL_LANES
+                           : (pack_type::ALL_LANES >> (width - count + i));
+    fetch(i, lights);
+
+    std::array<pack_type, 3> lightv;
+    for (size_t a = 0; a < 3; ++a)
+      lightv[a] = lights.position[a] - pack_type::broadcast(point[a]);
+
+    const auto distance_squared = lightv[0] * lightv[0] +
+                                  lightv[1] * lightv[1] +
+                                  lightv[2] * lightv[2];
+
+    // light_window, lane-wise
+    const auto x = distance_squared * lights.inverse_range_squared;
+    auto window = max(one - x * x, zero);
+    window = window * window;
+
+    const auto inverse_length = rsqrt(distance_squared);
+
+    auto light_dot_normal = zero;
+    auto light_dot_eye = zero;
+    for (size_t a = 0; a < 3; ++a) {
+      lightv[a] = lightv[a] * inverse_length;
+      light_dot_normal =
+          light_dot_normal + lightv[a] * pack_type::broadcast(n[a]);
+      light_dot_eye =
+          light_dot_eye + lightv[a] * pack_type::broadcast(eye_normal[a]);
+    }
+
+    const auto lit = valid & (window > zero) & (light_dot_normal >= zero);
+    if (lit == 0)
+      continue;
+
+    // reflect(-l, n) . eye without forming the reflection
+    const auto reflect_dot_eye =
+        two * light_dot_normal * n_dot_eye - light_dot_eye;
+    const auto shiny = lit & (reflect_dot_eye > zero);
+
+    const auto diffuse_factor = select(lit, light_dot_normal * window, zero);
+    const auto specular_factor =
+        shiny == 0 ? zero
+                   : select(shiny,
+                            simd::power(select(shiny, reflect_dot_eye, one),
+                                        shininess) *
+                                window,
+                            zero);
+
+    for (size_t c = 0; c < 3; ++c) {
+      diffuse[c] = diffuse[c] + diffuse_factor * lights.diffuse[c];
+      specular[c] = specular[c] + specular_factor * lights.specular[c];
+    }
+  }
+
+  clr1 color{0, 0, 0};
+  for (size_t c = 0; c < 3; ++c) {
+    const auto total = diffuse[c] + specular[c];
+    for (size_t lane = 0; lane < width; ++lane)
+      color[c] += total[lane];
+  }
+  return color;
+}
+} // namespace detail
+
+// Phong shading against every light of the set, LIGHT_PACK_WIDTH lights per
+// step; equal to the sum of the single-light lighting() over the set
+[[nodiscard]] inline clr1 lighting(const baked_light_set &baked,
+                                   const vec4 &point, const vec4 &eye_normal,
+                                   const normal &n) {
+  using pack_type = detail::light_pack::pack_type;
+
+  const auto fetch = [&](const size_t i, detail::light_pack &lights) {
+    for (size_t c = 0; c < 3; ++c) {
+      lights.position[c] = pack_type::load(baked.position[c].data() + i);
+      lights.diffuse[c] = pack_type::load(baked.diffuse[c].data() + i);
+      lights.specular[c] = pack_type::load(baked.specular[c].data() + i);
+    }
+    lights.inverse_range_squared =
+        pack_type::load(baked.inverse_range_squared.data() + i);
+  };
+
+  return baked.ambient + detail::shade_light_packs(baked.size, fetch,
+                                                   baked.shininess, point,
+                                                   eye_normal, n);
+}
+
+// Only the lights listed in indices contribute diffuse and specular, as
+// returned by light_grid::lights_near(); ambient still comes from all of
+// them. Equal to the full version whenever the lights left out are out of
+// range of point.
+[[nodiscard]] inline clr1 lighting(const baked_light_set &baked,
+                                   const light_indices &indices,
+                                   const vec4 &point, const vec4 &eye_normal,
+                                   const normal &n) {
+  constexpr size_t width{constants::LIGHT_PACK_WIDTH};
+  using pack_type = detail::light_pack::pack_type;
+
+  const auto fetch = [&](const size_t i, detail::light_pack &lights) {
+    const size_t count = std::min(width, indices.size() - i);
+
+    alignas(simd::alignment_v<real, width>) std::array<real, width> lanes{};
+    const auto gather = [&](const std::vector<real> &component) {
+      for (size_t lane = 0; lane < count; ++lane)
+        lanes[lane] = component[indices[i + lane]];
+      return pack_type::load(lanes.data());
+    };
+
+    for (size_t c = 0; c < 3; ++c) {
+      lights.position[c] = gather(baked.position[c]);
+      lights.diffuse[c] = gather(baked.diffuse[c]);
+      lights.specular[c] = gather(baked.specular[c]);
+    }
+    lights.inverse_range_squared = gather(baked.inverse_range_squared);
+  };
+
+  return baked.ambient + detail::shade_light_packs(indices.size(), fetch,
+                                                   baked.shininess, point,
+                                                   eye_normal, n);
+}
+
+[[nodiscard]] inline clr1 lighting(const material &mat,
+                                   const light_set &lights, const vec4 &point,
+                                   const vec4 &eye_normal, const normal &n) {
+  return lighting(bake_lighting(mat, lights), point, eye_normal, n);
+}
+} // namespace rtm
+
+#endif
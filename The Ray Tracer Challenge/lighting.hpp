@@ -5,39 +5,83 @@
 #include "math_utils.hpp"
 #include "sphere.hpp"
 #include "vec.hpp"
+#include <limits>
 
 namespace rtm {
+// range is the light's radius of influence: its diffuse and specular
+// contributions fade out smoothly and reach zero there. Infinite by default,
+// which leaves the intensity constant with distance.
 struct point_light {
   clr1 intensity{1, 1, 1};
   vec4 position{0, 0, 0, 1};
+  real range{std::numeric_limits<real>::infinity()};
 };
 
-constexpr clr1 lighting(const material &mat, const point_light &light,
-                        const vec4 &point, const vec4 &eye_normal,
-                        const normal &n) {
-  auto effective_color = mat.color * light.intensity;
-  auto lightv = normalize(light.position - point);
+// (1 - (d / range)^4)^2 clamped to [0, 1]: 1 at the light, 0 from range on,
+// with a flat start and end. Takes the squared distance and 1 / range^2,
+// which is 0 for an infinite range.
+[[nodiscard]] constexpr real light_window(const real distance_squared,
+                                          const real inverse_range_squared) {
+  const real x = distance_squared * inverse_range_squared;
+  const real falloff = 1 - x * x;
+  return falloff > 0 ? falloff * falloff : real{};
+}
 
-  auto ambient = effective_color * mat.ambient;
-  clr1 diffuse = {0, 0, 0};
-  clr1 specular = {0, 0, 0};
+// Everything lighting() derives from a material and a light alone. Bake each
+// pair once per frame rather than once per shading sample.
+struct baked_lighting {
+  clr1 ambient;  // color * intensity * ambient
+  clr1 diffuse;  // color * intensity * diffuse
+  clr1 specular; // intensity * specular
+  vec4 light_position;
+  real inverse_range_squared;
+  fixed_power<real> shininess;
+};
+
+[[nodiscard]] constexpr baked_lighting bake_lighting(const material &mat,
+                                                     const point_light &light) {
+  const auto effective_color = mat.color * light.intensity;
+
+  return {.ambient = effective_color * mat.ambient,
+          .diffuse = effective_color * mat.diffuse,
+          .specular = light.intensity * mat.specular,
+          .light_position = light.position,
+          .inverse_range_squared = 1 / (light.range * light.range),
+          .shininess = fixed_power<real>{mat.shininess}};
+}
 
-  auto light_dot_normal = dot_product(lightv, n);
+// In shadow only the ambient term is left
+constexpr clr1 lighting(const baked_lighting &baked, const vec4 &point,
+                        const vec4 &eye_normal, const normal &n,
+                        const bool in_shadow = false) {
+  if (in_shadow)
+    return baked.ambient;
+
+  const auto to_light = baked.light_position - point;
+  const auto window = light_window(dot_product(to_light, to_light),
+                                   baked.inverse_range_squared);
+  if (window == 0)
+    return baked.ambient;
+
+  const auto lightv = normalize(to_light);
+  const auto light_dot_normal = dot_product(lightv, n);
 
   if (light_dot_normal < 0)
-    return ambient + diffuse + specular;
+    return baked.ambient;
+
+  auto color = baked.ambient + baked.diffuse * (light_dot_normal * window);
 
-  diffuse = effective_color * mat.diffuse * light_dot_normal;
-  auto reflectv = reflect(-lightv, n);
-  auto reflect_dot_eye = dot_product(reflectv, eye_normal);
+  const auto reflect_dot_eye = dot_product(reflect(-lightv, n), eye_normal);
+  if (reflect_dot_eye > 0)
+    color += baked.specular * (baked.shininess(reflect_dot_eye) * window);
 
-    // C4244 Implicit conversion (const long double) -> (int)
-  if (reflect_dot_eye > 0) {
-    auto factor = power(reflect_dot_eye, mat.shininess);
-    specular = light.intensity * mat.specular * factor;
-  }
+  return color;
+}
 
-  return ambient + diffuse + specular;
+constexpr clr1 lighting(const material &mat, const point_light &light,
+                        const vec4 &point, const vec4 &eye_normal,
+                        const normal &n, const bool in_shadow = false) {
+  return lighting(bake_lighting(mat, light), point, eye_normal, n, in_shadow);
 }
 
 } // namespace rtm
@@ -1,24 +1,38 @@
+#include "camera.hpp"
 #include "canvas.hpp"
 #include "lighting.hpp"
+#include "primitive.hpp"
+#include "renderer.hpp"
 #include "scene_object_tests.hpp" // Assuming this contains your math/scene classes
 #include <iostream>
 #include <memory>
 
+#include "bvh_tests.hpp"
+#include "camera_tests.hpp"
 #include "math_tests.hpp"
+#include "render_tests.hpp"
+#include "world_tests.hpp"
 
-// Define canvas dimensions in one place for clarity and easy modification
+// Default canvas dimensions; the canvas itself is sized at run time
 namespace
 {
-	constexpr int CANVAS_WIDTH = 3000;
-	constexpr int CANVAS_HEIGHT = 3000;
+	constexpr size_t CANVAS_WIDTH = 3000;
+	constexpr size_t CANVAS_HEIGHT = 3000;
 } // namespace
 
 // The render function is encapsulated for clean design.
-// The canvas is passed by reference to be modified.
-void render(rtm::canvas<CANVAS_WIDTH, CANVAS_HEIGHT>& scene)
+// The canvas is passed by reference to be modified, the pool decides how many
+// threads work on it.
+void render(rtm::canvas& scene, rtm::thread_pool& pool)
 {
-	// Camera position in the world
-	constexpr auto camera_origin = rtm::vec<4, long double>{0.0, 0.0, -1.5, 1};
+	// Eye 1.5 units in front of the sphere, framing it as the old projection
+	// plane did: a canvas-sized plane about 500 units away
+	const auto field_of_view =
+		2 * rtm::c_atan(static_cast<rtm::real>(scene.width()) / 2 / rtm::real{501.5});
+
+	rtm::camera camera{scene.width(), scene.height(), field_of_view};
+	camera.set_transform(rtm::view_transform<rtm::real>(
+		{0, 0, -1.5, 1}, {0, 0, 0, 1}, {0, 1, 0, 0}));
 
 	// A sphere at the origin
 	auto sphere = rtm::sphere::make();
@@ -28,72 +42,48 @@ void render(rtm::canvas<CANVAS_WIDTH, CANVAS_HEIGHT>& scene)
 
 	// sphere->set_transform(rtm::matrix_translate({ 1.0, 0.0, 0.0 }));
 
-	// The Z position of the virtual "screen" or projection plane
-	constexpr long double projection_plane_z = 500;
-
-	// World coordinates corresponding to the top-left of the canvas
-	constexpr auto world_min_x = -CANVAS_WIDTH / 2.0;
-	constexpr auto world_min_y = -CANVAS_HEIGHT / 2.0;
+	// Material and light terms that do not change from pixel to pixel
+	const auto baked_lighting = rtm::bake_lighting(sphere->properties, light_source);
 
-	// Iterate over each pixel of the canvas using 0-based indexing
-	for (int y = 0; y < CANVAS_HEIGHT; ++y) // y represents the row
+	// Shades a single pixel; y represents the row, x the column (0-based).
+	// Only reads the scene, so it is safe to call from several threads.
+	auto shade_pixel = [&](const size_t y, const size_t x) -> rtm::clr255
 	{
-		for (int x = 0; x < CANVAS_WIDTH; ++x) // x represents the column
-		{
-			const auto world_x = world_min_x + x;
-			const auto world_y = world_min_y + y;
-			const auto point_on_plane =
-				rtm::vec<4, long double>{world_x, world_y, projection_plane_z, 1.0};
-
-			const auto ray_direction = rtm::normalize(point_on_plane - camera_origin);
-			const rtm::ray<long double> ray = {camera_origin, ray_direction};
-
-			auto hit = sphere->intersect(ray);
-
-			if (hit.has_value())
-			{
-				auto point = rtm::position(ray, hit.value()[0].t);
-				auto normal = rtm::normal_at(std::dynamic_pointer_cast<rtm::sphere>(
-					                             hit.value()[0].object.lock()),
-				                             point);
-				auto eye = -ray.direction;
-
-				const rtm::clr1 final_color_fp =
-					rtm::lighting(sphere->properties, light_source, point, eye, normal);
-
-				// Helper function for clamping might be useful
-				auto clamp = [](long double value, long double min, long double max)
-				{
-					if (value < min)
-						return min;
-					if (value > max)
-						return max;
-					return value;
-				};
-
-				// 2. Scale, clamp, and cast each component
-				uint8_t r =
-					static_cast<uint8_t>(clamp(final_color_fp[0] * 255.0, 0.0, 255.0));
-				uint8_t g =
-					static_cast<uint8_t>(clamp(final_color_fp[1] * 255.0, 0.0, 255.0));
-				uint8_t b =
-					static_cast<uint8_t>(clamp(final_color_fp[2] * 255.0, 0.0, 255.0));
-
-				scene(y, x) = rtm::clr255{r, g, b};
-			}
-		}
-	}
+		const rtm::ray<rtm::real> ray = camera.ray_for_pixel(y, x);
+
+		auto hit = rtm::dispatch_intersect(*sphere, ray);
+
+		if (!hit.has_value())
+			return {};
+
+		auto point = rtm::position(ray, hit.value()[0].t);
+		auto normal = rtm::normal_at(*sphere, point);
+		auto eye = -ray.direction;
+
+		const rtm::clr1 final_color_fp =
+			rtm::lighting(baked_lighting, point, eye, normal);
+
+		return rtm::to_clr255(final_color_fp);
+	};
+
+	rtm::render_tiled(scene, shade_pixel, pool);
 }
 
 int main()
 {
-	//rtm::canvas<CANVAS_WIDTH, CANVAS_HEIGHT> scene{};
+	//rtm::canvas scene{CANVAS_WIDTH, CANVAS_HEIGHT};
+	//rtm::thread_pool pool{}; // one worker per hardware thread by default
 
-	//render(scene);
+	//render(scene, pool);
+	//scene.save("out.ppm");
 
 	rtm::testing::perform_math_tests();
 	rtm::testing::perform_scene_tests();
 	rtm::testing::perform_misc_tests();
+	rtm::testing::perform_render_tests();
+	rtm::testing::perform_bvh_tests();
+	rtm::testing::perform_camera_tests();
+	rtm::testing::perform_world_tests();
 
 	// 91 strona lighting and shading
 
@@ -1,6 +1,9 @@
 #ifndef MATH_TESTS_HPP
 #define MATH_TESTS_HPP
 #include "scene_object_tests.hpp"
+#include "simd_math.hpp"
+#include <bit>
+#include <cstdint>
 
 namespace rtm::testing
 {
@@ -271,6 +274,145 @@ namespace rtm::testing
 			         -0.26666667, 0.33333333
 		         });*/
 
+		// Closed-form 4x4 determinant agrees with cofactor expansion along a row
+		{
+			constexpr matrix<4, 4, long double> A{
+				9, 3, 0, 9, -5, -2, -6, -3, -4, 9, 6, 4, -7, 6, 6, 2
+			};
+
+			long double expansion{};
+			for (size_t c = 0; c < 4; ++c)
+				expansion += A(0, c) * matrix_cofactor(A, 0, c);
+
+			expected(expansion, matrix_determinant(A));
+			expected(identity_matrix<4, long double>(), A * matrix_inverse(A));
+		}
+
+		// Affine inverse matches the general inverse and refuses projective input
+		{
+			const auto transform = matrix_translate<long double>({ 10, 5, 7 }) *
+				matrix_rotate_y<long double>(constants::PI / 3) *
+				matrix_shear<long double>(1, 0, 0.5L) *
+				matrix_scale<long double>({ 2, 3, 4 });
+
+			expected(true, is_affine_matrix(transform));
+			expected(matrix_inverse(transform), matrix_inverse_affine(transform));
+
+			bool thrown = false;
+			try
+			{
+				auto projective{ identity_matrix<4, long double>() };
+				projective(3, 2) = 1;
+				(void)matrix_inverse_affine(projective);
+			}
+			catch (const std::domain_error&)
+			{
+				thrown = true;
+			}
+			expected(true, thrown);
+		}
+
+		// Singularity is judged against the matrix's own scale: small uniform
+		// scales invert in every precision, rank-deficient matrices still throw
+		{
+			const auto small_scale = [](auto unit)
+			{
+				using T = decltype(unit);
+				const auto scale = matrix_scale<T>({ T(0.01L), T(0.01L), T(0.01L) });
+				const auto expected_inverse = matrix_scale<T>({ 100, 100, 100 });
+
+				expected(expected_inverse, matrix_inverse(scale));
+				expected(expected_inverse, matrix_inverse_affine(scale));
+				expected(matrix<3, 3, T>{
+					100, 0, 0,
+					0, 100, 0,
+					0, 0, 100 }, matrix_inverse(matrix<3, 3, T>{
+					T(0.01L), 0, 0,
+					0, T(0.01L), 0,
+					0, 0, T(0.01L) }));
+			};
+			small_scale(0.f);
+			small_scale(0.);
+			small_scale(0.L);
+
+			const auto throws = [](const auto& mat)
+			{
+				try
+				{
+					(void)matrix_inverse(mat);
+				}
+				catch (const std::domain_error&)
+				{
+					return true;
+				}
+				return false;
+			};
+			expected(true, throws(matrix_scale<float>({ 1, 0, 1 })));
+			expected(true, throws(matrix<4, 4, double>{
+				1, 2, 3, 4,
+				2, 4, 6, 8,
+				0, 1, 0, 0,
+				0, 0, 0, 1 }));
+			expected(true, throws(matrix_scale<long double>({ 1e-3L, 1, 1e3L }) *
+				matrix<4, 4, long double>{
+					1, 1, 0, 0,
+					1, 1, 0, 0,
+					0, 0, 1, 0,
+					0, 0, 0, 1 }));
+			expected(true, throws(matrix_scale<double>({
+				std::numeric_limits<double>::infinity(), 1, 1 })));
+		}
+
+		// 3x4 affine transforms agree with the 4x4 matrices they replace
+		{
+			const auto A = matrix_translate<real>({ 1, -2, 3 }) * matrix_rotate_x<real>(0.3L) *
+				matrix_scale<real>({ 2, 1, 0.5L });
+			const auto B = matrix_shear<real>(0.5L, 0, 0, 1) * matrix_translate<real>({ -4, 0, 2 });
+			const affine<real> a{ A };
+			const affine<real> b{ B };
+
+			const vec<4, real> point{ 0.5L, -1, 2, 1 };
+			const vec<4, real> direction{ 1, 2, -3, 0 };
+
+			expected(A * point, a.transform_point(point));
+			expected(A * direction, a.transform_direction(direction));
+			expected(A * point, a * point);
+			expected(A * B, a * b);
+			expected(matrix_inverse(A), affine_inverse(a));
+			expected(identity_matrix<4, real>(), a * affine_inverse(a));
+			expected(true, sizeof(affine<real>) * 4 <= sizeof(matrix<4, 4, real>) * 3);
+
+			bool thrown = false;
+			try
+			{
+				auto projective{ identity_matrix<4, real>() };
+				projective(3, 0) = 2;
+				(void)affine<real>{ projective };
+			}
+			catch (const std::domain_error&)
+			{
+				thrown = true;
+			}
+			expected(true, thrown);
+		}
+
+		// Transforms classify exactly, and anything else is general
+		{
+			expected(transform_class::identity, classify(affine<real>{}));
+			expected(transform_class::translation,
+				classify(affine<real>{ matrix_translate<real>({ 1, 0, -2 }) }));
+			expected(transform_class::uniform_scale,
+				classify(affine<real>{ matrix_translate<real>({ 1, 0, -2 }) * matrix_scale<real>({ 3, 3, 3 }) }));
+			expected(transform_class::general,
+				classify(affine<real>{ matrix_scale<real>({ 3, 3, 2 }) }));
+			expected(transform_class::general,
+				classify(affine<real>{ matrix_scale<real>({ -1, -1, -1 }) }));
+			expected(transform_class::general,
+				classify(affine<real>{ matrix_rotate_y<real>(0.3L) }));
+			expected(transform_class::general,
+				classify(affine<real>{ matrix_shear<real>(0.5L, 0, 0, 0, 0, 0) }));
+		}
+
 		expected(std::multiplies{}, vec<4, int>{2, 1, 7, 1}, matrix_translate<int>({ 5, -3, 2 }), vec<4, int>{-3, 4, 5, 1});
 
 		expected(std::multiplies{}, vec<4, int>{-8, 7, 3, 1}, matrix_cast<int>(matrix_inverse(matrix_translate<int>({ 5, -3, 2 }))), vec<4, int>{-3, 4, 5, 1});
@@ -401,7 +543,7 @@ namespace rtm::testing
 		}*/
 
 		{
-			constexpr auto A = matrix_rotate_x(constants::PI / 2);
+			constexpr auto A = matrix_rotate_x<long double>(constants::PI / 2);
 			constexpr auto B = matrix_scale<long double>({ 5, 5, 5 });
 			constexpr auto C = matrix_translate<long double>({ 10, 5, 7 });
 
@@ -411,6 +553,138 @@ namespace rtm::testing
 			expected(C * B * A * vec<4, long double>{1, 0, 1, 1}, vec<4, long double>{15, 0, 7, 1});
 		}
 
+		// Run-time (vector kernel where available) and constant-evaluated
+		// (scalar) paths agree bit for bit
+		{
+			constexpr matrix<4, 4, double> a{8, -5, 9, 2, 7, 5, 6, 1, -6, 0, 9, 6, -3, 0, -9, -4};
+			constexpr matrix<4, 4, double> b{0.1, 3, 0, 9, -5, -2.5, -6, -3, -4, 9, 6, 4, -7, 6, 6, 2};
+			constexpr vec<4, double> v{0.3, -1.7, 2.9, 1};
+
+			constexpr auto ct_mat_vec = a * v;
+			constexpr auto ct_mat_mat = a * b;
+			constexpr auto ct_dot = dot_product(v, vec<4, double>{1.1, 2.2, -3.3, 0});
+
+			auto rt_mat_vec = a * v;
+			auto rt_mat_mat = a * b;
+			auto rt_dot = dot_product(v, vec<4, double>{1.1, 2.2, -3.3, 0});
+
+			expected(true, std::ranges::equal(ct_mat_vec, rt_mat_vec));
+			expected(true, std::ranges::equal(ct_mat_mat, rt_mat_mat));
+			expected(true, std::bit_cast<std::uint64_t>(ct_dot) == std::bit_cast<std::uint64_t>(rt_dot));
+
+			constexpr vec<4, float> f{1.5f, -2.25f, 0.125f, 0.f};
+			constexpr auto ct_f = (-f + f * 2.f - f / 4.f) * f;
+			auto rt_f = (-f + f * 2.f - f / 4.f) * f;
+
+			expected(true, std::ranges::equal(ct_f, rt_f));
+			// Exact in any summation order, so the reduction must match
+			expected(true, dot_product(f, f) == 7.328125f);
+
+			// Pairwise summation gives 2 here, the scalar order 1
+			constexpr vec<4, float> cancel{1e8f, 1.f, -1e8f, 1.f};
+			constexpr vec<4, float> ones{1.f, 1.f, 1.f, 1.f};
+			constexpr auto ct_cancel = dot_product(cancel, ones);
+			auto rt_cancel = dot_product(cancel, ones);
+
+			expected(true, std::bit_cast<std::uint32_t>(ct_cancel) == std::bit_cast<std::uint32_t>(rt_cancel));
+			expected(true, rt_cancel == 1.f);
+		}
+
+		// Constant evaluation runs the series, run time the library; both agree
+		{
+			constexpr double ct_sin = c_sin(1.25);
+			constexpr double ct_cos = c_cos(-2.5);
+			constexpr double ct_tan = c_tan(0.75);
+			constexpr double ct_sqrt = c_sqrt(14.);
+			constexpr double ct_atan = c_atan(3.);
+			constexpr double ct_acos = c_acos(-0.25);
+
+			expected(ct_sin, c_sin(1.25));
+			expected(ct_cos, c_cos(-2.5));
+			expected(ct_tan, c_tan(0.75));
+			expected(ct_sqrt, c_sqrt(14.));
+			expected(ct_atan, c_atan(3.));
+			expected(ct_acos, c_acos(-0.25));
+			expected(true, std::isnan(c_sqrt(-1.)));
+
+			constexpr double ct_log2 = c_log2(0.3);
+			constexpr double ct_exp2 = c_exp2(-3.7);
+			constexpr double ct_pow = c_pow(0.8, 10.5);
+			constexpr double ct_whole_pow = c_pow(1.5, -3.);
+
+			expected(ct_log2, c_log2(0.3));
+			expected(ct_exp2, c_exp2(-3.7));
+			expected(ct_pow, c_pow(0.8, 10.5));
+			expected(ct_whole_pow, c_pow(1.5, -3.));
+		}
+
+		// Powers by squaring, with the exponent fixed ahead of time
+		{
+			expected(1024., power(2., 10));
+			expected(0.125, power(2., -3));
+			expected(1., power(7., 0));
+
+			constexpr fixed_power<double> whole{200};
+			constexpr fixed_power<double> fractional{10.5};
+			static_assert(whole(1.) == 1.);
+
+			expected(std::pow(0.97, 200.), whole(0.97));
+			expected(std::pow(0.97, 10.5), fractional(0.97));
+			expected(10.5, fractional.exponent());
+		}
+
+		// Batch math matches the scalar functions, remainder lanes included
+		{
+			size_t mismatches = 0;
+
+			const auto check = [&]<typename T>()
+			{
+				constexpr size_t count = 37;
+
+				std::vector<T> angles(count), lengths(count);
+				for (size_t i = 0; i < count; ++i)
+				{
+					angles[i] = static_cast<T>(-20. + 40. * static_cast<double>(i) / (count - 1));
+					lengths[i] = static_cast<T>(0.01 + 3. * static_cast<double>(i * i));
+				}
+
+				std::vector<T> roots(count), inverse_roots(count), sines(count), cosines(count);
+				simd::batch_sqrt<T>(lengths, roots);
+				simd::batch_rsqrt<T>(lengths, inverse_roots);
+				simd::batch_sincos<T>(angles, sines, cosines);
+
+				for (size_t i = 0; i < count; ++i)
+				{
+					mismatches += !are_close(std::sqrt(lengths[i]), roots[i]);
+					mismatches += !are_close(1 / std::sqrt(lengths[i]), inverse_roots[i]);
+					mismatches += !are_close(std::sin(angles[i]), sines[i]);
+					mismatches += !are_close(std::cos(angles[i]), cosines[i]);
+				}
+
+				// In place
+				simd::batch_sqrt<T>(lengths, lengths);
+				mismatches += !std::ranges::equal(roots, lengths);
+			};
+
+			check.template operator()<float>();
+			check.template operator()<double>();
+			check.template operator()<long double>();
+
+			expected(size_t{0}, mismatches);
+
+			std::vector<real> too_short(3);
+			bool threw = false;
+			try
+			{
+				simd::batch_sqrt<real>(std::vector<real>(4), too_short);
+			}
+			catch (const std::invalid_argument&)
+			{
+				threw = true;
+			}
+			expected(true, threw);
+		}
+
 		//{
 		//	auto point_1 = vec<4, long double>{1, 0, 1, 1};
 
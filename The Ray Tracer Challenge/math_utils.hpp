@@ -1,9 +1,25 @@
 #ifndef NUMERICS_HPP
 #define NUMERICS_HPP
+#include <cmath>
+#include <concepts>
 #include <fstream>
+#include <limits>
 #include <numbers>
+#include <type_traits>
 
 namespace rtm {
+// Precision policy: the floating-point type the geometry pipeline (vectors,
+// rays, objects, materials, shading) runs in. Pick one at compile time with
+// RTM_PRECISION_FLOAT or RTM_PRECISION_DOUBLE; long double is the default and
+// the reference the test suite checks against.
+#if defined(RTM_PRECISION_FLOAT)
+using real = float;
+#elif defined(RTM_PRECISION_DOUBLE)
+using real = double;
+#else
+using real = long double;
+#endif
+
 namespace constants {
 inline constexpr size_t VEC_SPACING{9};
 inline constexpr size_t MATRIX_SPACING{12};
@@ -14,6 +30,12 @@ inline constexpr long double EPSILON{
 inline constexpr long double PI{std::numbers::pi_v<long double>};
 inline constexpr long double TWO_PI{2.l * PI};
 inline constexpr long double HALF_PI{.5l * PI};
+
+// Comparison tolerance per precision; float cannot resolve 1e-6 around the
+// magnitudes the scene works with
+template <std::floating_point T>
+inline constexpr T EPSILON_V{static_cast<T>(EPSILON)};
+template <> inline constexpr float EPSILON_V<float>{1e-4f};
 } // namespace constants
 
 template <typename T>
@@ -28,7 +50,7 @@ constexpr T c_max(T lhs, T rhs) noexcept {
   return (lhs < rhs) ? lhs : rhs;
 }
 
-template <std::floating_point T, T EPSILON = constants::EPSILON>
+template <std::floating_point T, T EPSILON = constants::EPSILON_V<T>>
 [[nodiscard]] constexpr bool are_close(const T lhs, const T rhs) {
   if (lhs == rhs) // exact
     return true;
@@ -49,14 +71,20 @@ template <std::floating_point T, T EPSILON = constants::EPSILON>
   return radians * 180 / constants::PI;
 }
 
+// Exponentiation by squaring, log2(exp) multiplies instead of exp
 template <std::floating_point T> constexpr T power(T base, int exp) noexcept {
-  if (exp == 0)
-    return 1;
+  const bool negative = exp < 0;
+  auto remaining = negative ? 0U - static_cast<unsigned>(exp)
+                            : static_cast<unsigned>(exp);
+
   T result = 1;
-  for (int i = 0; i < exp; ++i) {
-    result *= base;
+  while (remaining != 0) {
+    if (remaining & 1U)
+      result *= base;
+    base *= base;
+    remaining >>= 1;
   }
-  return result;
+  return negative ? 1 / result : result;
 }
 
 template <std::floating_point T> constexpr T factorial(int n) noexcept {
@@ -69,7 +97,14 @@ template <std::floating_point T> constexpr T factorial(int n) noexcept {
   return result;
 }
 
+// The c_* functions below evaluate their series only during constant
+// evaluation; at run time they hand over to the hardware instruction or libm,
+// which are both faster and more accurate.
+
 template <std::floating_point T> [[nodiscard]] constexpr T c_sin(T x) noexcept {
+  if (!std::is_constant_evaluated())
+    return std::sin(x);
+
   // Normalize x to the range [-PI, PI]
   while (x > constants::PI)
     x -= constants::TWO_PI;
@@ -85,6 +120,9 @@ template <std::floating_point T> [[nodiscard]] constexpr T c_sin(T x) noexcept {
 }
 
 template <std::floating_point T> [[nodiscard]] constexpr T c_cos(T x) noexcept {
+  if (!std::is_constant_evaluated())
+    return std::cos(x);
+
   // Normalize x to the range [-PI, PI]
   while (x > constants::PI)
     x -= constants::TWO_PI;
@@ -100,11 +138,17 @@ template <std::floating_point T> [[nodiscard]] constexpr T c_cos(T x) noexcept {
 }
 
 template <std::floating_point T> [[nodiscard]] constexpr T c_tan(T x) noexcept {
+  if (!std::is_constant_evaluated())
+    return std::tan(x);
+
   return c_sin(x) / c_cos(x);
 }
 
 template <std::floating_point T>
 [[nodiscard]] constexpr T c_sqrt(T x) noexcept {
+  if (!std::is_constant_evaluated())
+    return std::sqrt(x);
+
   if (x < 0)
     return std::numeric_limits<T>::quiet_NaN();
   if (x == 0)
@@ -122,8 +166,123 @@ template <std::floating_point T>
   return guess;
 }
 
+template <std::floating_point T>
+[[nodiscard]] constexpr T c_log2(T x) noexcept {
+  if (!std::is_constant_evaluated())
+    return std::log2(x);
+
+  if (!(x >= 0))
+    return std::numeric_limits<T>::quiet_NaN();
+  if (x == 0)
+    return -std::numeric_limits<T>::infinity();
+  if (x == std::numeric_limits<T>::infinity())
+    return x;
+
+  // x = m * 2^e with m in [1, 2)
+  T e = 0;
+  while (x >= 2) {
+    x /= 2;
+    ++e;
+  }
+  while (x < 1) {
+    x *= 2;
+    --e;
+  }
+
+  // ln(m) = 2 atanh(z) with z = (m - 1) / (m + 1) <= 1/3
+  const T z = (x - 1) / (x + 1);
+  T term = z;
+  T result = 0;
+  for (int n = 0; n < 20; ++n) {
+    result += term / (2 * n + 1);
+    term *= z * z;
+  }
+  return e + 2 * result / std::numbers::ln2_v<T>;
+}
+
+template <std::floating_point T>
+[[nodiscard]] constexpr T c_exp2(T x) noexcept {
+  if (!std::is_constant_evaluated())
+    return std::exp2(x);
+
+  if (x != x)
+    return x;
+  if (x >= std::numeric_limits<T>::max_exponent)
+    return std::numeric_limits<T>::infinity();
+  if (x < std::numeric_limits<T>::min_exponent - std::numeric_limits<T>::digits)
+    return 0;
+
+  // 2^x = 2^n * e^(f ln 2) with n the nearest integer and |f| <= 1/2
+  const int n = static_cast<int>(x < 0 ? x - T{0.5} : x + T{0.5});
+  const T y = (x - n) * std::numbers::ln2_v<T>;
+
+  T term = 1;
+  T result = 0;
+  for (int k = 1; k <= 20; ++k) {
+    result += term;
+    term *= y / k;
+  }
+  return result * power(T{2}, n);
+}
+
+// base^exp for any real exponent; integral ones are exact products
+template <std::floating_point T>
+[[nodiscard]] constexpr T c_pow(T base, T exp) noexcept {
+  if (!std::is_constant_evaluated())
+    return std::pow(base, exp);
+
+  if (c_abs(exp) <= std::numeric_limits<int>::max() &&
+      exp == static_cast<T>(static_cast<int>(exp)))
+    return power(base, static_cast<int>(exp));
+  if (base < 0)
+    return std::numeric_limits<T>::quiet_NaN();
+  if (base == 0)
+    return exp > 0 ? T{} : std::numeric_limits<T>::infinity();
+
+  return c_exp2(exp * c_log2(base));
+}
+
+// x^exponent for one exponent and many positive bases. Whether the exponent
+// is a whole number is decided once: if so every call is exponentiation by
+// squaring, otherwise exp2(exponent * log2(x)).
+template <std::floating_point T> class fixed_power {
+public:
+  constexpr explicit fixed_power(const T exponent) noexcept
+      : m_exponent{exponent} {
+    if (c_abs(exponent) <= MAX_SQUARING_EXPONENT &&
+        exponent == static_cast<T>(static_cast<int>(exponent))) {
+      m_integral = true;
+      m_integer = static_cast<int>(exponent);
+    }
+  }
+
+  [[nodiscard]] constexpr T exponent() const noexcept { return m_exponent; }
+
+  // Whether calls go through exponentiation by squaring, and by what power
+  [[nodiscard]] constexpr bool integral() const noexcept { return m_integral; }
+
+  [[nodiscard]] constexpr int integer() const noexcept { return m_integer; }
+
+  [[nodiscard]] constexpr T operator()(const T base) const noexcept {
+    if (m_integral)
+      return power(base, m_integer);
+    return c_exp2(m_exponent * c_log2(base));
+  }
+
+private:
+  // Larger whole exponents are rare enough to take the general path
+  static constexpr T MAX_SQUARING_EXPONENT{1 << 16};
+
+  T m_exponent;
+  bool m_integral{false};
+  int m_integer{};
+};
+
 template <std::floating_point T>
 [[nodiscard]] constexpr T c_atan(T x) noexcept {
+  if (!std::is_constant_evaluated())
+    return std::atan(x);
+
   if (x == 0)
     return 0;
   if (x > 1)
@@ -140,6 +299,9 @@ template <std::floating_point T>
 
 template <std::floating_point T>
 [[nodiscard]] constexpr T c_asin(T x) noexcept {
+  if (!std::is_constant_evaluated())
+    return std::asin(x);
+
   if (x > 1 || x < -1)
     return std::numeric_limits<T>::quiet_NaN();
   return c_atan(x / c_sqrt(1 - x * x));
@@ -147,6 +309,9 @@ template <std::floating_point T>
 
 template <std::floating_point T>
 [[nodiscard]] constexpr T c_acos(T x) noexcept {
+  if (!std::is_constant_evaluated())
+    return std::acos(x);
+
   if (x > 1 || x < -1)
     return std::numeric_limits<T>::quiet_NaN();
   return constants::HALF_PI - c_asin(x);
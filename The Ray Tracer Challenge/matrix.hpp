@@ -5,11 +5,13 @@
 #include <array>
 #include <concepts>
 #include <iomanip>
+#include <limits>
 #include <ranges>
 #include <stdexcept>
 #include <type_traits>
 
 #include "math_utils.hpp"
+#include "simd.hpp"
 #include "vec.hpp"
 
 namespace rtm
@@ -182,14 +184,28 @@ namespace rtm
 
 		constexpr auto end() noexcept { return m_linear_buffer.end(); }
 
+		[[nodiscard]] constexpr const T* data() const noexcept { return m_linear_buffer.data(); }
+
+		[[nodiscard]] constexpr T* data() noexcept { return m_linear_buffer.data(); }
+
 	private:
-		std::array<T, R * C> m_linear_buffer{};
+		// rows of 4 float/double line up with vector registers
+		alignas(simd::alignment_v<T, C>) std::array<T, R * C> m_linear_buffer{};
 	};
 
 	template <size_t E, typename T>
 	constexpr matrix<E, E, T>& operator*=(matrix<E, E, T>& lhs,
 	                                      const matrix<E, E, T>& rhs)
 	{
+		if constexpr (simd::accelerated_v<T, E>)
+		{
+			if (!std::is_constant_evaluated())
+			{
+				simd::mat4_mul_mat4(lhs.data(), rhs.data(), lhs.data());
+				return lhs;
+			}
+		}
+
 		std::array<T, E> row_buffer{};
 
 		for (size_t r = 0; r < E; ++r)
@@ -278,6 +294,15 @@ namespace rtm
 	{
 		vec<R, T> temporary{};
 
+		if constexpr (R == 4 && simd::accelerated_v<T, C>)
+		{
+			if (!std::is_constant_evaluated())
+			{
+				simd::mat4_mul_vec4(lhs.data(), rhs.data(), temporary.data());
+				return temporary;
+			}
+		}
+
 		for (size_t r = 0; r < R; ++r)
 			for (size_t c = 0; c < C; ++c)
 				temporary[r] += lhs(r, c) * rhs[c];
@@ -477,6 +502,115 @@ namespace rtm
 		return MatrixCofactor{}(mat, row, col);
 	}
 
+	namespace detail
+	{
+		// The twelve 2x2 minors a 4x4 determinant and inverse are built from:
+		// s from rows 0 and 1, c from rows 2 and 3
+		template <typename T>
+		struct minors_4x4
+		{
+			T s0, s1, s2, s3, s4, s5;
+			T c0, c1, c2, c3, c4, c5;
+
+			[[nodiscard]] constexpr T determinant() const
+			{
+				return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+			}
+		};
+
+		template <typename T>
+		[[nodiscard]] constexpr minors_4x4<T> minors_2x2(const matrix<4, 4, T>& m)
+		{
+			return {
+				m(0, 0) * m(1, 1) - m(1, 0) * m(0, 1),
+				m(0, 0) * m(1, 2) - m(1, 0) * m(0, 2),
+				m(0, 0) * m(1, 3) - m(1, 0) * m(0, 3),
+				m(0, 1) * m(1, 2) - m(1, 1) * m(0, 2),
+				m(0, 1) * m(1, 3) - m(1, 1) * m(0, 3),
+				m(0, 2) * m(1, 3) - m(1, 2) * m(0, 3),
+				m(2, 0) * m(3, 1) - m(3, 0) * m(2, 1),
+				m(2, 0) * m(3, 2) - m(3, 0) * m(2, 2),
+				m(2, 0) * m(3, 3) - m(3, 0) * m(2, 3),
+				m(2, 1) * m(3, 2) - m(3, 1) * m(2, 2),
+				m(2, 1) * m(3, 3) - m(3, 1) * m(2, 3),
+				m(2, 2) * m(3, 3) - m(3, 2) * m(2, 3)
+			};
+		}
+
+		// Singular when the determinant is small next to the largest entry of
+		// each of the first N rows (a bound on |det| up to a constant), so the
+		// test follows the matrix's scale: a uniform scale of 0.01 is as
+		// invertible as one of 100. Non-finite determinants are singular too.
+		template <size_t N, typename T, typename M, typename RT>
+		constexpr void check_invertible(const M& m, const RT determinant)
+		{
+			if constexpr (std::floating_point<T>)
+			{
+				RT scale{ 1 };
+
+				for (size_t r = 0; r < N; ++r)
+				{
+					RT largest{};
+
+					for (size_t c = 0; c < N; ++c)
+						largest = std::max(largest, c_abs(static_cast<RT>(m(r, c))));
+
+					scale *= largest;
+				}
+
+				const RT magnitude = c_abs(determinant);
+
+				if (!(magnitude <= std::numeric_limits<RT>::max()) ||
+					magnitude <= constants::EPSILON_V<RT> * scale)
+					throw std::domain_error("Matrix inversion undefined for singular zero "
+						"value determinant matrix");
+			}
+			else
+			{
+				if (determinant == T{})
+					throw std::domain_error("Matrix inversion undefined for singular zero "
+						"value determinant matrix");
+			}
+		}
+
+		// Inverse of the affine transform held in the top three rows of m,
+		// written to the top three rows of out; both are indexed (row, col).
+		// Cofactors of the first column double as the determinant expansion.
+		template <typename T, typename In, typename Out>
+		constexpr void invert_affine_rows(const In& m, Out& out)
+		{
+			using RT = std::remove_cvref_t<decltype(out(0, 0))>;
+
+			const T c00 = m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1);
+			const T c10 = m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2);
+			const T c20 = m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0);
+
+			const RT determinant = m(0, 0) * c00 + m(0, 1) * c10 + m(0, 2) * c20;
+
+			check_invertible<3, T>(m, determinant);
+
+			const T adjugate[3][3]{
+				{ c00, m(0, 2) * m(2, 1) - m(0, 1) * m(2, 2), m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1) },
+				{ c10, m(0, 0) * m(2, 2) - m(0, 2) * m(2, 0), m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2) },
+				{ c20, m(0, 1) * m(2, 0) - m(0, 0) * m(2, 1), m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0) }
+			};
+
+			for (size_t r = 0; r < 3; ++r)
+			{
+				for (size_t c = 0; c < 3; ++c)
+				{
+					out(r, c) = static_cast<RT>(adjugate[r][c]) / determinant;
+				}
+			}
+
+			for (size_t r = 0; r < 3; ++r)
+			{
+				out(r, 3) = -(out(r, 0) * m(0, 3) + out(r, 1) * m(1, 3) +
+					out(r, 2) * m(2, 3));
+			}
+		}
+	} // namespace detail
+
 	template <typename V = void>
 	struct MatrixDeterminant
 	{
@@ -486,6 +620,16 @@ namespace rtm
 			return mat(0, 0) * mat(1, 1) - mat(0, 1) * mat(1, 0);
 		}
 
+		// Closed form from the 2x2 minors of the top and bottom row pairs
+		// (Laplace expansion), instead of recursing through 3x3 cofactors
+		template <typename T>
+		[[nodiscard]] constexpr T operator()(const matrix<4, 4, T>& mat)
+		{
+			const auto minors = detail::minors_2x2(mat);
+
+			return minors.determinant();
+		}
+
 		template <size_t E, typename T>
 		[[nodiscard]] constexpr T operator()(const matrix<E, E, T>& mat)
 		{
@@ -532,6 +676,52 @@ namespace rtm
 	template <typename V = void>
 	struct MatrixInverse
 	{
+		// Adjugate from the same twelve 2x2 minors as the determinant
+		template <typename T>
+		[[nodiscard]] constexpr auto operator()(const matrix<4, 4, T>& m) -> matrix<4, 4, std::conditional_t<std::floating_point<T>, T, long double>>
+		{
+			using RT = std::conditional_t<std::floating_point<T>, T, long double>;
+
+			const auto n = detail::minors_2x2(m);
+			const RT determinant = n.determinant();
+
+			detail::check_invertible<4, T>(m, determinant);
+
+			const matrix<4, 4, T> adjugate{
+				m(1, 1) * n.c5 - m(1, 2) * n.c4 + m(1, 3) * n.c3,
+				-m(0, 1) * n.c5 + m(0, 2) * n.c4 - m(0, 3) * n.c3,
+				m(3, 1) * n.s5 - m(3, 2) * n.s4 + m(3, 3) * n.s3,
+				-m(2, 1) * n.s5 + m(2, 2) * n.s4 - m(2, 3) * n.s3,
+
+				-m(1, 0) * n.c5 + m(1, 2) * n.c2 - m(1, 3) * n.c1,
+				m(0, 0) * n.c5 - m(0, 2) * n.c2 + m(0, 3) * n.c1,
+				-m(3, 0) * n.s5 + m(3, 2) * n.s2 - m(3, 3) * n.s1,
+				m(2, 0) * n.s5 - m(2, 2) * n.s2 + m(2, 3) * n.s1,
+
+				m(1, 0) * n.c4 - m(1, 1) * n.c2 + m(1, 3) * n.c0,
+				-m(0, 0) * n.c4 + m(0, 1) * n.c2 - m(0, 3) * n.c0,
+				m(3, 0) * n.s4 - m(3, 1) * n.s2 + m(3, 3) * n.s0,
+				-m(2, 0) * n.s4 + m(2, 1) * n.s2 - m(2, 3) * n.s0,
+
+				-m(1, 0) * n.c3 + m(1, 1) * n.c1 - m(1, 2) * n.c0,
+				m(0, 0) * n.c3 - m(0, 1) * n.c1 + m(0, 2) * n.c0,
+				-m(3, 0) * n.s3 + m(3, 1) * n.s1 - m(3, 2) * n.s0,
+				m(2, 0) * n.s3 - m(2, 1) * n.s1 + m(2, 2) * n.s0
+			};
+
+			matrix<4, 4, RT> temporary{};
+
+			for (size_t r = 0; r < 4; ++r)
+			{
+				for (size_t c = 0; c < 4; ++c)
+				{
+					temporary(r, c) = static_cast<RT>(adjugate(r, c)) / determinant;
+				}
+			}
+
+			return temporary;
+		}
+
 		template <size_t E, typename T>
 		[[nodiscard]] constexpr auto operator()(const matrix<E, E, T>& mat) -> matrix<E, E, std::conditional_t<std::floating_point<T>, T, long double>>
 		{
@@ -539,18 +729,7 @@ namespace rtm
 
 			const RT determinant = matrix_determinant(mat);
 
-			if constexpr (std::floating_point<T>)
-			{
-				if (are_close(determinant, T{}))
-					throw std::domain_error("Matrix inversion undefined for singular zero "
-						"value determinant matrix");
-			}
-			else
-			{
-				if (determinant == T{})
-					throw std::domain_error("Matrix inversion undefined for singular zero "
-						"value determinant matrix");
-			}
+			detail::check_invertible<E, T>(mat, determinant);
 
 			matrix<E, E, RT> transposed{};
 
@@ -575,10 +754,54 @@ namespace rtm
 		return MatrixInverse{}(mat);
 	}
 
+	template <typename V = void>
+	struct AffineMatrix
+	{
+		template <typename T>
+		[[nodiscard]] constexpr bool operator()(const matrix<4, 4, T>& mat)
+		{
+			return mat(3, 0) == T{} && mat(3, 1) == T{} && mat(3, 2) == T{} && mat(3, 3) == T{ 1 };
+		}
+	};
+
+	template <typename T>
+	[[nodiscard]] constexpr bool is_affine_matrix(const matrix<4, 4, T>& mat)
+	{
+		return AffineMatrix{}(mat);
+	}
+
+	// Inverse of a matrix whose bottom row is 0 0 0 1: invert the 3x3 linear
+	// part and move the translation through it
+	template <typename V = void>
+	struct MatrixInverseAffine
+	{
+		template <typename T>
+		[[nodiscard]] constexpr auto operator()(const matrix<4, 4, T>& m) -> matrix<4, 4, std::conditional_t<std::floating_point<T>, T, long double>>
+		{
+			using RT = std::conditional_t<std::floating_point<T>, T, long double>;
+
+			if (!is_affine_matrix(m))
+				throw std::domain_error("Affine inversion requires a 0 0 0 1 bottom row");
+
+			auto temporary{ identity_matrix<4, RT>() };
+
+			detail::invert_affine_rows<T>(m, temporary);
+
+			return temporary;
+		}
+	};
+
+	template <typename T>
+	[[nodiscard]] constexpr matrix<4, 4, std::conditional_t<std::floating_point<T>, T, long double>>
+	matrix_inverse_affine(const matrix<4, 4, T>& mat)
+	{
+		return MatrixInverseAffine{}(mat);
+	}
+
 	template <typename V = void>
 	struct MatrixTranslate
 	{
-		template <typename T = long double>
+		template <typename T = real>
 		[[nodiscard]] constexpr matrix<4, 4, T> operator()(const vec<3, T>& vec)
 		{
 			auto temporary{ identity_matrix<4, T>() };
@@ -592,7 +815,7 @@ namespace rtm
 		}
 	};
 
-	template <typename T = long double>
+	template <typename T = real>
 	[[nodiscard]] constexpr matrix<4, 4, T> matrix_translate(const vec<3, T>& vec)
 	{
 		return MatrixTranslate{}(vec);
@@ -601,7 +824,7 @@ namespace rtm
 	template <typename V = void>
 	struct MatrixScale
 	{
-		template <typename T = long double>
+		template <typename T = real>
 		[[nodiscard]] constexpr matrix<4, 4, T> operator()(const vec<3, T>& vec)
 		{
 			auto temporary{ identity_matrix<4, T>() };
@@ -615,7 +838,7 @@ namespace rtm
 		}
 	};
 
-	template <typename T = long double>
+	template <typename T = real>
 	[[nodiscard]] constexpr matrix<4, 4, T> matrix_scale(const vec<3, T>& vec)
 	{
 		return MatrixScale{}(vec);
@@ -624,7 +847,7 @@ namespace rtm
 	template <typename V = void>
 	struct MatrixShear
 	{
-		template <typename T = long double>
+		template <typename T = real>
 		[[nodiscard]] constexpr matrix<4, 4, T> operator()(const T x_y, const T x_z = {}, const T y_x = {}, const T y_z = {},
 			const T z_x = {}, const T z_y = {})
 		{
@@ -635,7 +858,7 @@ namespace rtm
 		}
 	};
 
-	template <typename T = long double>
+	template <typename T = real>
 	[[nodiscard]] constexpr matrix<4, 4, T>
 	matrix_shear(const T x_y, const T x_z = {}, const T y_x = {}, const T y_z = {},
 	             const T z_x = {}, const T z_y = {})
@@ -646,60 +869,69 @@ namespace rtm
 	template <typename V = void>
 	struct MatrixRotateX
 	{
-		template <typename T = long double>
+		template <typename T = real>
 		[[nodiscard]] constexpr matrix<4, 4, T> operator()(const long double rad)
 		{
+			const auto cosine = static_cast<T>(c_cos(rad));
+			const auto sine = static_cast<T>(c_sin(rad));
+
 			return matrix<4, 4, T>{
-				1, 0, 0, 0, 0, c_cos(rad),
-					-c_sin(rad), 0, 0, c_sin(rad), c_cos(rad), 0,
+				1, 0, 0, 0, 0, cosine,
+					-sine, 0, 0, sine, cosine, 0,
 					0, 0, 0, 1
 			};
 		}
 	};
 
-	template <typename T = long double>
+	template <typename T = real>
 	[[nodiscard]] constexpr matrix<4, 4, T> matrix_rotate_x(const long double rad)
 	{
-		return MatrixRotateX{}(rad);
+		return MatrixRotateX{}.template operator()<T>(rad);
 	}
 
 	template <typename V = void>
 	struct MatrixRotateY
 	{
-		template <typename T = long double>
+		template <typename T = real>
 		[[nodiscard]] constexpr matrix<4, 4, T> operator()(const long double rad)
 		{
+			const auto cosine = static_cast<T>(c_cos(rad));
+			const auto sine = static_cast<T>(c_sin(rad));
+
 			return matrix<4, 4, T>{
-				c_cos(rad), 0, c_sin(rad), 0, 0, 1, 0, 0,
-					-c_sin(rad), 0, c_cos(rad), 0, 0, 0, 0, 1
+				cosine, 0, sine, 0, 0, 1, 0, 0,
+					-sine, 0, cosine, 0, 0, 0, 0, 1
 			};
 		}
 	};
 	
-	template <typename T = long double>
+	template <typename T = real>
 	[[nodiscard]] constexpr matrix<4, 4, T> matrix_rotate_y(const long double rad)
 	{
-		return MatrixRotateY{}(rad);
+		return MatrixRotateY{}.template operator()<T>(rad);
 	}
 
 	template <typename V = void>
 	struct MatrixRotateZ
 	{
-		template <typename T = long double>
+		template <typename T = real>
 		[[nodiscard]] constexpr matrix<4, 4, T> operator()(const long double rad)
 		{
+			const auto cosine = static_cast<T>(c_cos(rad));
+			const auto sine = static_cast<T>(c_sin(rad));
+
 			return matrix<4, 4, T>{
-				c_cos(rad), -c_sin(rad), 0, 0, c_sin(rad), c_cos(rad),
+				cosine, -sine, 0, 0, sine, cosine,
 					0, 0, 0, 0, 1, 0,
 					0, 0, 0, 1
 			};
 		}
 	};
 
-	template <typename T = long double>
+	template <typename T = real>
 	[[nodiscard]] constexpr matrix<4, 4, T> matrix_rotate_z(const long double rad)
 	{
-		return MatrixRotateZ{}(rad);
+		return MatrixRotateZ{}.template operator()<T>(rad);
 	}
 } // namespace rtm
 
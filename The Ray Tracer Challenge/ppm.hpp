@@ -0,0 +1,127 @@
+#ifndef PPM_HPP
+#define PPM_HPP
+
+#include "vec.hpp"
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+namespace rtm {
+namespace constants {
+inline constexpr int PPM_MAX_COLOR_VALUE{255};
+// Encoded bytes collected before each write to the file
+inline constexpr size_t PPM_WRITE_CHUNK{1ULL << 20};
+} // namespace constants
+
+// binary is P6, one byte per channel; ascii is P3, kept for debugging and
+// for viewers that only read the plain format
+enum class ppm_format { binary, ascii };
+
+inline void write_ppm_header(std::ostream &os, const size_t width,
+                             const size_t height, const ppm_format format) {
+  os << (format == ppm_format::binary ? "P6" : "P3") << '\n'
+     << width << ' ' << height << '\n'
+     << constants::PPM_MAX_COLOR_VALUE << '\n';
+}
+
+// Appends one row of pixels in the given format to out
+inline void encode_ppm_row(std::span<const clr255> row,
+                           const ppm_format format, std::string &out) {
+  if (format == ppm_format::binary) {
+    const size_t offset = out.size();
+    out.resize(offset + row.size() * 3);
+
+    if constexpr (sizeof(clr255) == 3) {
+      std::memcpy(out.data() + offset, row.data(), row.size() * 3);
+    } else {
+      char *p = out.data() + offset;
+      for (const auto &pixel : row) {
+        *p++ = static_cast<char>(pixel.r());
+        *p++ = static_cast<char>(pixel.g());
+        *p++ = static_cast<char>(pixel.b());
+      }
+    }
+    return;
+  }
+
+  // "255 255 255 " is the widest a pixel gets
+  char digits[12];
+  for (const auto &pixel : row) {
+    char *p = digits;
+    for (const auto channel : {pixel.r(), pixel.g(), pixel.b()}) {
+      p = std::to_chars(p, digits + sizeof(digits), static_cast<int>(channel))
+              .ptr;
+      *p++ = ' ';
+    }
+    out.append(digits, p);
+  }
+  out.push_back('\n');
+}
+
+// Writes a PPM file row by row, top to bottom, through a chunk buffer.
+// Failures to open or write the file throw std::runtime_error.
+class ppm_writer {
+public:
+  ppm_writer(const std::filesystem::path &path, const size_t width,
+             const size_t height, const ppm_format format = ppm_format::binary)
+      : m_path{path}, m_width{width}, m_height{height}, m_format{format},
+        m_file{path, std::ios::binary} {
+    if (!m_file)
+      throw std::runtime_error("ppm: cannot open " + m_path.string());
+
+    m_buffer.reserve(constants::PPM_WRITE_CHUNK + width * 12 + 1);
+    write_ppm_header(m_file, width, height, format);
+  }
+
+  ppm_writer(const ppm_writer &) = delete;
+  ppm_writer &operator=(const ppm_writer &) = delete;
+
+  [[nodiscard]] size_t rows_written() const { return m_rows; }
+
+  void write_row(std::span<const clr255> row) {
+    if (row.size() != m_width)
+      throw std::invalid_argument("ppm: row width does not match the image");
+    if (m_rows == m_height)
+      throw std::length_error("ppm: more rows than the image height");
+
+    encode_ppm_row(row, m_format, m_buffer);
+    ++m_rows;
+
+    if (m_buffer.size() >= constants::PPM_WRITE_CHUNK)
+      flush();
+  }
+
+  // Writes what is buffered and checks the whole image made it to disk
+  void finish() {
+    if (m_rows != m_height)
+      throw std::length_error("ppm: image is missing rows");
+
+    flush();
+    m_file.flush();
+    if (!m_file)
+      throw std::runtime_error("ppm: write failed for " + m_path.string());
+  }
+
+private:
+  std::filesystem::path m_path;
+  size_t m_width;
+  size_t m_height;
+  ppm_format m_format;
+  std::ofstream m_file;
+  std::string m_buffer{};
+  size_t m_rows{};
+
+  void flush() {
+    m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    if (!m_file)
+      throw std::runtime_error("ppm: write failed for " + m_path.string());
+    m_buffer.clear();
+  }
+};
+} // namespace rtm
+
+#endif
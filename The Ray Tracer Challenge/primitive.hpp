@@ -0,0 +1,180 @@
+#ifndef PRIMITIVE_HPP
+#define PRIMITIVE_HPP
+
+#include "hit.hpp"
+#include "scene_object.hpp"
+#include "sphere.hpp"
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace rtm {
+// Calls f with obj as its concrete primitive type, or as plain object for
+// custom types. Adding a built-in primitive means a new primitive_kind, a
+// friend of object for its tagged constructor, a case here and a bucket in
+// primitive_buckets.
+template <typename F> decltype(auto) visit_primitive(const object &obj, F &&f) {
+  switch (obj.kind()) {
+  case primitive_kind::sphere:
+    return std::forward<F>(f)(static_cast<const sphere &>(obj));
+  case primitive_kind::custom:
+    break;
+  }
+  return std::forward<F>(f)(obj);
+}
+
+// Per-type kernels; the object overload is the virtual fallback
+[[nodiscard]] inline std::optional<rtm::intersects>
+intersect_primitive(const sphere &sph, const ray<real> &r) {
+  if (sph.simple())
+    return sph.intersect_shape(sph.shape(), r);
+  return sph.intersect_unit_sphere(sph.to_local(r));
+}
+
+[[nodiscard]] inline std::optional<rtm::intersects>
+intersect_primitive(const object &obj, const ray<real> &r) {
+  return obj.intersect(r);
+}
+
+template <size_t W>
+[[nodiscard]] rtm::packet_intersects<W, real>
+intersect_primitive(const sphere &sph, const ray_packet<W, real> &packet) {
+  if (sph.simple())
+    return sph.intersect_shape(sph.shape(), packet);
+
+  auto local_packet = packet;
+  local_packet.transform(sph.inverse_transform());
+  return sph.intersect_unit_sphere(local_packet);
+}
+
+template <size_t W>
+[[nodiscard]] rtm::packet_intersects<W, real>
+intersect_primitive(const object &obj, const ray_packet<W, real> &packet) {
+  return obj.intersect_packet(packet);
+}
+
+// object::intersect() without the virtual call for built-in primitives
+[[nodiscard]] inline std::optional<rtm::intersects>
+dispatch_intersect(const object &obj, const ray<real> &r) {
+  return visit_primitive(obj, [&r](const auto &primitive) {
+    return intersect_primitive(primitive, r);
+  });
+}
+
+template <size_t W>
+[[nodiscard]] rtm::packet_intersects<W, real>
+dispatch_intersect(const object &obj, const ray_packet<W, real> &packet) {
+  return visit_primitive(obj, [&packet](const auto &primitive) {
+    return intersect_primitive(primitive, packet);
+  });
+}
+
+// object::normal_at() without the virtual call for built-in primitives
+[[nodiscard]] inline normal normal_primitive(const sphere &sph,
+                                             const vec4 &world_point) {
+  return normal_at(sph, world_point);
+}
+
+[[nodiscard]] inline normal normal_primitive(const object &obj,
+                                             const vec4 &world_point) {
+  return obj.normal_at(world_point);
+}
+
+[[nodiscard]] inline normal normal_at(const object &obj,
+                                      const vec4 &world_point) {
+  return visit_primitive(obj, [&world_point](const auto &primitive) {
+    return normal_primitive(primitive, world_point);
+  });
+}
+
+// Whether obj has a root in [0, t_max) along r: the any-hit counterpart of
+// hit(), for shadow rays
+[[nodiscard]] inline bool occludes(const object &obj, const ray<real> &r,
+                                   const real t_max) {
+  const auto xs = dispatch_intersect(obj, r);
+  return xs && std::ranges::any_of(*xs, [t_max](const rtm::intersect &x) {
+           return x.t >= 0 && x.t < t_max;
+         });
+}
+
+// Reference closest hit: every object, in order
+[[nodiscard]] inline std::optional<rtm::intersect>
+closest_hit(std::span<const std::shared_ptr<object>> objects,
+            const ray<real> &r) {
+  std::optional<rtm::intersect> closest;
+
+  for (const auto &current : objects) {
+    if (const auto xs = current->intersect(r)) {
+      if (const auto h = hit(*xs); h && (!closest || h->t < closest->t))
+        closest = h;
+    }
+  }
+
+  return closest;
+}
+
+// Objects grouped by primitive type, so every group runs a single kernel in
+// a loop the compiler can inline and vectorize. The buckets refer to the
+// objects, which must outlive them.
+class primitive_buckets {
+public:
+  primitive_buckets() = default;
+
+  explicit primitive_buckets(
+      std::span<const std::shared_ptr<object>> objects) {
+    for (const auto &current : objects)
+      add(*current);
+  }
+
+  void add(const object &obj) {
+    visit_primitive(obj, [this](const auto &primitive) {
+      using primitive_type = std::remove_cvref_t<decltype(primitive)>;
+      std::get<std::vector<const primitive_type *>>(m_buckets).push_back(
+          &primitive);
+    });
+  }
+
+  template <typename P>
+  [[nodiscard]] const std::vector<const P *> &bucket() const {
+    return std::get<std::vector<const P *>>(m_buckets);
+  }
+
+  [[nodiscard]] size_t size() const {
+    size_t total = 0;
+    for_each_bucket([&total](const auto &b) { total += b.size(); });
+    return total;
+  }
+
+  // f is called once per bucket with a vector of concrete-type pointers
+  template <typename F> void for_each_bucket(F &&f) const {
+    std::apply([&f](const auto &...buckets) { (f(buckets), ...); },
+               m_buckets);
+  }
+
+  [[nodiscard]] std::optional<rtm::intersect>
+  closest_hit(const ray<real> &r) const {
+    std::optional<rtm::intersect> closest;
+
+    for_each_bucket([&](const auto &b) {
+      for (const auto *primitive : b) {
+        if (const auto xs = intersect_primitive(*primitive, r)) {
+          if (const auto h = hit(*xs); h && (!closest || h->t < closest->t))
+            closest = h;
+        }
+      }
+    });
+
+    return closest;
+  }
+
+private:
+  std::tuple<std::vector<const sphere *>, std::vector<const object *>>
+      m_buckets{};
+};
+} // namespace rtm
+
+#endif
@@ -7,7 +7,7 @@
 
 namespace rtm
 {
-	template <typename T = long double>
+	template <typename T = real>
 	struct ray
 	{
 		vec<4, T> origin{T{0}, T{0}, T{0}, T{1}};
@@ -44,7 +44,7 @@ namespace rtm
 
 	template <typename T>
 	[[nodiscard]] constexpr vec<4, T> position(const ray<T>& r,
-	                                           const long double t)
+	                                           const std::type_identity_t<T> t)
 	{
 		return vec<4, T>{r.origin + r.direction * t};
 	}
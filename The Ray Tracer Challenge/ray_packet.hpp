@@ -0,0 +1,88 @@
+#ifndef RAY_PACKET_HPP
+#define RAY_PACKET_HPP
+
+#include "affine.hpp"
+#include "matrix.hpp"
+#include "ray.hpp"
+#include "simd_pack.hpp"
+#include <array>
+#include <span>
+
+namespace rtm {
+// W coherent rays (e.g. primary rays of neighbouring pixels) in
+// structure-of-arrays form: lane i of every component belongs to ray i.
+// Origins are points and directions vectors, so w is implied.
+template <size_t W, typename T = real>
+  requires(W == 4 || W == 8)
+struct ray_packet {
+  using pack_type = simd::pack<T, W>;
+  using mask_type = typename pack_type::mask_type;
+
+  static constexpr size_t WIDTH{W};
+
+  pack_type origin_x{};
+  pack_type origin_y{};
+  pack_type origin_z{};
+  pack_type direction_x{};
+  pack_type direction_y{};
+  pack_type direction_z{};
+
+  [[nodiscard]] static ray_packet gather(std::span<const ray<T>, W> rays) {
+    std::array<std::array<T, W>, 6> lanes{};
+
+    for (size_t i = 0; i < W; ++i) {
+      for (size_t axis = 0; axis < 3; ++axis) {
+        lanes[axis][i] = rays[i].origin[axis];
+        lanes[3 + axis][i] = rays[i].direction[axis];
+      }
+    }
+
+    return {pack_type::load(lanes[0].data()), pack_type::load(lanes[1].data()),
+            pack_type::load(lanes[2].data()), pack_type::load(lanes[3].data()),
+            pack_type::load(lanes[4].data()), pack_type::load(lanes[5].data())};
+  }
+
+  [[nodiscard]] ray<T> lane(const size_t i) const {
+    return {{origin_x[i], origin_y[i], origin_z[i], T{1}},
+            {direction_x[i], direction_y[i], direction_z[i], T{0}}};
+  }
+
+  void transform(const affine<T> &a) { transform_rows(a); }
+
+  // Affine transforms only, the bottom row is not read
+  void transform(const matrix<4, 4, T> &mat) { transform_rows(mat); }
+
+private:
+  // Mat is indexed (row, col) over its top three rows
+  template <typename Mat> void transform_rows(const Mat &mat) {
+    const auto row = [&mat](const size_t r, const pack_type &x,
+                            const pack_type &y, const pack_type &z) {
+      return pack_type::broadcast(mat(r, 0)) * x +
+             pack_type::broadcast(mat(r, 1)) * y +
+             pack_type::broadcast(mat(r, 2)) * z;
+    };
+
+    const auto translation = [&mat](const size_t r) {
+      return pack_type::broadcast(mat(r, 3));
+    };
+
+    const ray_packet source = *this;
+
+    origin_x = row(0, source.origin_x, source.origin_y, source.origin_z) +
+               translation(0);
+    origin_y = row(1, source.origin_x, source.origin_y, source.origin_z) +
+               translation(1);
+    origin_z = row(2, source.origin_x, source.origin_y, source.origin_z) +
+               translation(2);
+
+    direction_x =
+        row(0, source.direction_x, source.direction_y, source.direction_z);
+    direction_y =
+        row(1, source.direction_x, source.direction_y, source.direction_z);
+    direction_z =
+        row(2, source.direction_x, source.direction_y, source.direction_z);
+  }
+};
+} // namespace rtm
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef RENDER_TESTS_HPP
+#define RENDER_TESTS_HPP
+
+#include "bounded_queue.hpp"
+#include "canvas.hpp"
+#include "renderer.hpp"
+#include "test_helpers.hpp"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rtm::testing {
+inline std::string read_file(const std::filesystem::path &path) {
+  std::ifstream file{path, std::ios::binary};
+  return std::string{std::istreambuf_iterator<char>{file}, {}};
+}
+
+inline void perform_render_tests() {
+  // Tiles cover the frame exactly once, edge tiles are clipped
+  {
+    const auto tiles = make_tiles(37, 23, 8);
+
+    expected(15, static_cast<int>(tiles.size()));
+    expected(37, static_cast<int>(tiles.back().col_end));
+    expected(23, static_cast<int>(tiles.back().row_end));
+  }
+
+  // Tiled rendering on any number of threads matches the serial path
+  {
+    constexpr size_t width = 37;
+    constexpr size_t height = 23;
+
+    // Deliberately uneven cost per pixel
+    auto shade = [](const size_t r, const size_t c) {
+      long double value = 0;
+      for (size_t i = 0; i < (r * c) % 97; ++i)
+        value += c_sqrt(static_cast<long double>(i + r + c));
+      return static_cast<int>(value);
+    };
+
+    std::vector<int> serial(width * height, -1);
+    auto serial_target = [&](const size_t r, const size_t c) -> int & {
+      return serial[r * width + c];
+    };
+    render_serial(serial_target, width, height, shade);
+
+    for (const size_t thread_count : {1, 3, 8}) {
+      thread_pool pool{thread_count};
+
+      std::vector<int> tiled(width * height, -1);
+      auto tiled_target = [&](const size_t r, const size_t c) -> int & {
+        return tiled[r * width + c];
+      };
+      render_tiled(tiled_target, width, height, shade, pool, 8);
+
+      expected(true, serial == tiled);
+    }
+  }
+
+  // Exceptions thrown inside a task surface on wait()
+  {
+    thread_pool pool{2};
+    bool caught = false;
+
+    try {
+      pool.parallel_for(0, 4, [](const size_t i) {
+        if (i == 2)
+          throw std::runtime_error("task failure");
+      });
+    } catch (const std::runtime_error &) {
+      caught = true;
+    }
+
+    expected(true, caught);
+  }
+
+  // parallel_for visits every index exactly once, whether or not the range
+  // divides into the pool's pieces, and an empty range does nothing
+  {
+    thread_pool pool{3};
+
+    for (const size_t count : {0, 1, 5, 12, 13, 1000}) {
+      std::vector<std::atomic<int>> visits(count + 2);
+      pool.parallel_for(1, count + 1, [&visits](const size_t i) {
+        visits[i].fetch_add(1, std::memory_order_relaxed);
+      });
+
+      size_t wrong = 0;
+      for (size_t i = 0; i < visits.size(); ++i)
+        if (visits[i].load() != (i >= 1 && i <= count ? 1 : 0))
+          ++wrong;
+      expected(size_t{0}, wrong);
+    }
+  }
+
+  // Streaming to a file gives the same bytes as rendering a canvas and
+  // saving it, for bands that do and do not divide the height
+  {
+    const auto directory = std::filesystem::temp_directory_path();
+
+    constexpr size_t width = 37;
+    constexpr size_t height = 23;
+    auto shade = [](const size_t r, const size_t c) {
+      return clr255{static_cast<uint8_t>(r * 7 + c),
+                    static_cast<uint8_t>(c * 3), static_cast<uint8_t>(r)};
+    };
+
+    thread_pool pool{3};
+
+    canvas reference{width, height};
+    render_serial(reference, shade);
+    reference.save(directory / "rtm_reference_test.ppm");
+
+    for (const size_t band_height : {1, 5, 8, 64}) {
+      render_streamed(directory / "rtm_streamed_test.ppm", width, height,
+                      shade, pool, ppm_format::binary, band_height);
+
+      expected(true, read_file(directory / "rtm_reference_test.ppm") ==
+                         read_file(directory / "rtm_streamed_test.ppm"));
+    }
+
+
+    // Floating-point colors are converted on the output thread; one band in
+    // flight serializes the stages, several let them overlap
+    auto shade_color = [&shade](const size_t r, const size_t c) {
+      const auto pixel = shade(r, c);
+      return vec<3, float>{pixel.r() / 255.f, pixel.g() / 255.f,
+                           pixel.b() / 255.f};
+    };
+
+    canvas converted{width, height};
+    render_serial(converted, [&](const size_t r, const size_t c) {
+      return to_clr255(shade_color(r, c));
+    });
+    converted.save(directory / "rtm_reference_test.ppm");
+
+    for (const size_t bands_in_flight : {1, 2, 4}) {
+      render_streamed(directory / "rtm_streamed_test.ppm", width, height,
+                      shade_color, pool, ppm_format::binary, 4,
+                      bands_in_flight);
+
+      expected(true, read_file(directory / "rtm_reference_test.ppm") ==
+                         read_file(directory / "rtm_streamed_test.ppm"));
+    }
+
+    // A failing shader stops the pipeline and surfaces to the caller
+    bool caught = false;
+    try {
+      render_streamed(directory / "rtm_streamed_test.ppm", width, height,
+                      [&shade](const size_t r, const size_t c) {
+                        if (r == 13)
+                          throw std::runtime_error("shader failure");
+                        return shade(r, c);
+                      },
+                      pool, ppm_format::binary, 2, 2);
+    } catch (const std::runtime_error &) {
+      caught = true;
+    }
+    expected(true, caught);
+
+    std::filesystem::remove(directory / "rtm_reference_test.ppm");
+    std::filesystem::remove(directory / "rtm_streamed_test.ppm");
+  }
+
+  // Producers block on a full queue until a consumer makes room
+  {
+    bounded_queue<int> queue{2};
+    std::atomic<int> pushed{0};
+
+    std::jthread producer{[&] {
+      for (int i = 0; i < 5; ++i) {
+        queue.push(i);
+        ++pushed;
+      }
+      queue.close();
+    }};
+
+    // Once the queue is full the producer must stay put
+    while (pushed.load() < 2)
+      std::this_thread::yield();
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    expected(2, pushed.load());
+
+    int sum = 0;
+    while (const auto item = queue.pop())
+      sum += *item;
+
+    expected(10, sum);
+    expected(false, queue.push(5));
+  }
+
+  // save() writes P6 by default, P3 on request, and reports bad paths
+  {
+    const auto directory = std::filesystem::temp_directory_path();
+
+    canvas image{3, 2};
+    image(0, 0) = constants::RED255;
+    image(0, 2) = constants::BLU255;
+    image(1, 1) = {10, 200, 7};
+
+    image.save(directory / "rtm_canvas_test.ppm");
+    // Compared as a bool, the raw bytes are no use printed
+    expected(true, std::string{"P6\n3 2\n255\n"
+                               "\xff\x00\x00\x00\x00\x00\x00\x00\xff"
+                               "\x00\x00\x00\x0a\xc8\x07\x00\x00\x00",
+                               29} ==
+                       read_file(directory / "rtm_canvas_test.ppm"));
+
+    image.save(directory / "rtm_canvas_test.ppm", ppm_format::ascii);
+    expected(std::string{"P3\n3 2\n255\n"
+                         "255 0 0 0 0 0 0 0 255 \n"
+                         "0 0 0 10 200 7 0 0 0 \n"},
+             read_file(directory / "rtm_canvas_test.ppm"));
+
+    std::filesystem::remove(directory / "rtm_canvas_test.ppm");
+
+    // Storage is aligned, dimensions come from the constructor
+    expected(size_t{0},
+             reinterpret_cast<uintptr_t>(image.data()) %
+                 constants::CANVAS_ALIGNMENT);
+    expected(size_t{3}, image.width());
+    expected(size_t{2}, image.height());
+    expected(true, image.row(1)[1] == clr255{10, 200, 7});
+
+    bool thrown = false;
+    try {
+      image.save(directory / "rtm_missing_directory" / "out.ppm");
+    } catch (const std::runtime_error &) {
+      thrown = true;
+    }
+    expected(true, thrown);
+  }
+}
+} // namespace rtm::testing
+
+#endif
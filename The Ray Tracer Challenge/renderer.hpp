@@ -0,0 +1,192 @@
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+#include "bounded_queue.hpp"
+#include "canvas.hpp"
+#include "ppm.hpp"
+#include "thread_pool.hpp"
+#include "tile.hpp"
+#include <algorithm>
+#include <concepts>
+#include <exception>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace rtm {
+namespace constants {
+// Band buffers shared by the render and output stages of render_streamed()
+inline constexpr size_t STREAM_BANDS_IN_FLIGHT{3};
+} // namespace constants
+
+// Target is anything addressable as target(row, col) = color, Shader is
+// invoked as shade(row, col). Every pixel is shaded exactly once and
+// independently, which is what keeps the tiled path bit-identical to the
+// serial one.
+template <typename Target, typename Shader>
+  requires std::invocable<Shader &, size_t, size_t>
+void render_tile(Target &target, const tile &t, Shader &shade) {
+  for (size_t r = t.row_begin; r < t.row_end; ++r)
+    for (size_t c = t.col_begin; c < t.col_end; ++c)
+      target(r, c) = shade(r, c);
+}
+
+template <typename Target, typename Shader>
+  requires std::invocable<Shader &, size_t, size_t>
+void render_serial(Target &target, const size_t width, const size_t height,
+                   Shader &&shade) {
+  render_tile(target, tile{0, 0, height, width}, shade);
+}
+
+// Tiles are handed to the pool in scanline order; the work-stealing
+// scheduler takes care of expensive tiles clustering in one region.
+template <typename Target, typename Shader>
+  requires std::invocable<Shader &, size_t, size_t>
+void render_tiled(Target &target, const size_t width, const size_t height,
+                  Shader &&shade, thread_pool &pool,
+                  const size_t tile_size = constants::TILE_SIZE) {
+  const auto tiles = make_tiles(width, height, tile_size);
+
+  pool.parallel_for(0, tiles.size(), [&](const size_t i) {
+    render_tile(target, tiles[i], shade);
+  });
+}
+
+template <typename Shader>
+  requires std::invocable<Shader &, size_t, size_t>
+void render_serial(canvas &target, Shader &&shade) {
+  render_serial(target, target.width(), target.height(), shade);
+}
+
+template <typename Shader>
+  requires std::invocable<Shader &, size_t, size_t>
+void render_tiled(canvas &target, Shader &&shade, thread_pool &pool,
+                  const size_t tile_size = constants::TILE_SIZE) {
+  render_tiled(target, target.width(), target.height(), shade, pool,
+               tile_size);
+}
+
+namespace detail {
+// What the output stage turns a shaded pixel into
+inline const clr255 &to_output_pixel(const clr255 &pixel) { return pixel; }
+
+template <std::floating_point T>
+clr255 to_output_pixel(const vec<3, T> &color) {
+  return to_clr255(color);
+}
+} // namespace detail
+
+// Renders straight to a PPM file without ever holding the whole frame. The
+// frame is cut into bands of band_height scanlines; the calling thread shades
+// each band tile by tile on the pool while a dedicated output thread converts,
+// encodes and writes the bands before it. bands_in_flight buffers circulate
+// between the two stages, so peak memory is that many bands whatever the
+// image height, and a slow disk stalls rendering instead of queueing frames.
+// Shaders may return clr255 or a floating-point color, in which case the
+// conversion happens on the output thread.
+template <typename Shader>
+  requires std::invocable<Shader &, size_t, size_t>
+void render_streamed(const std::filesystem::path &path, const size_t width,
+                     const size_t height, Shader &&shade, thread_pool &pool,
+                     const ppm_format format = ppm_format::binary,
+                     const size_t band_height = constants::TILE_SIZE,
+                     const size_t bands_in_flight =
+                         constants::STREAM_BANDS_IN_FLIGHT) {
+  using pixel_type =
+      std::remove_cvref_t<std::invoke_result_t<Shader &, size_t, size_t>>;
+
+  if (band_height == 0)
+    throw std::invalid_argument("Band height must be non-zero");
+
+  struct band {
+    size_t row_begin{};
+    size_t rows{};
+    std::vector<pixel_type> pixels{};
+  };
+
+  const size_t band_rows = std::min(band_height, height);
+  // Same tile layout for every band, rows relative to the band
+  const auto tiles = make_tiles(width, band_rows);
+
+  bounded_queue<band> free_bands{bands_in_flight};
+  bounded_queue<band> finished_bands{bands_in_flight};
+  for (size_t i = 0; i < bands_in_flight; ++i)
+    free_bands.push({0, 0, std::vector<pixel_type>(width * band_rows)});
+
+  // Opened here so a bad path throws before any thread starts
+  ppm_writer writer{path, width, height, format};
+  std::exception_ptr output_error;
+
+  std::jthread output{[&] {
+    try {
+      std::vector<clr255> converted(width);
+
+      while (auto finished = finished_bands.pop()) {
+        for (size_t r = 0; r < finished->rows; ++r) {
+          const auto *row = finished->pixels.data() + r * width;
+
+          if constexpr (std::is_same_v<pixel_type, clr255>) {
+            writer.write_row(std::span<const clr255>{row, width});
+          } else {
+            std::transform(row, row + width, converted.begin(),
+                           [](const pixel_type &pixel) {
+                             return detail::to_output_pixel(pixel);
+                           });
+            writer.write_row(converted);
+          }
+        }
+        free_bands.push(std::move(*finished));
+      }
+
+      if (writer.rows_written() == height)
+        writer.finish();
+    } catch (...) {
+      output_error = std::current_exception();
+      // Unblocks the renderer, which then stops
+      free_bands.close();
+    }
+  }};
+
+  try {
+    for (size_t band_begin = 0; band_begin < height;
+         band_begin += band_height) {
+      auto current = free_bands.pop();
+      if (!current)
+        break; // the output stage failed
+
+      current->row_begin = band_begin;
+      current->rows = std::min(band_height, height - band_begin);
+
+      auto band_target = [&](const size_t r, const size_t c) -> pixel_type & {
+        return current->pixels[(r - band_begin) * width + c];
+      };
+
+      pool.parallel_for(0, tiles.size(), [&](const size_t i) {
+        tile t = tiles[i];
+        if (t.row_begin >= current->rows)
+          return;
+        t.row_begin += band_begin;
+        t.row_end = std::min(t.row_end, current->rows) + band_begin;
+        render_tile(band_target, t, shade);
+      });
+
+      finished_bands.push(std::move(*current));
+    }
+  } catch (...) {
+    finished_bands.close();
+    output.join();
+    throw;
+  }
+
+  finished_bands.close();
+  output.join();
+
+  if (output_error)
+    std::rethrow_exception(output_error);
+}
+} // namespace rtm
+
+#endif
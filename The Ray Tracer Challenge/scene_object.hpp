@@ -1,11 +1,23 @@
 #ifndef SCENE_OBJECT_HPP
 #define SCENE_OBJECT_HPP
 
+#include "affine.hpp"
+#include "bounds.hpp"
 #include "intersect.hpp"
 #include "matrix.hpp"
 #include "ray.hpp"
+#include "ray_packet.hpp"
+#include <cstdint>
+#include <memory>
 
 namespace rtm {
+// Closed set of built-in primitives; visit_primitive() switches on it to
+// reach the concrete type without a virtual call. Types defined outside the
+// library are custom and go through the virtual interface.
+enum class primitive_kind : uint8_t { custom, sphere };
+
+class sphere;
+
 class object : public std::enable_shared_from_this<object> {
 public:
   constexpr object() = default;
@@ -20,44 +32,158 @@ public:
 
   constexpr object &operator=(object &&) noexcept = delete;
 
-  [[nodiscard]] constexpr const rtm::matrix<4, 4, long double> &
-  transform() const {
+  [[nodiscard]] constexpr primitive_kind kind() const { return m_kind; }
+
+  [[nodiscard]] constexpr const rtm::affine<real> &transform() const {
     return m_transform;
   }
 
-  [[nodiscard]] constexpr const rtm::matrix<4, 4, long double> &
-  inverse_transform() const {
+  [[nodiscard]] constexpr const rtm::affine<real> &inverse_transform() const {
     return m_inverse_transform;
   }
 
+  // Decided by set_transform(); primitives with closed forms for the simpler
+  // classes skip the ray transform for them
+  [[nodiscard]] constexpr transform_class classification() const {
+    return m_classification;
+  }
+
+  // World-space box around the object, derived from its local bounds
+  [[nodiscard]] rtm::aabb<real> bounds() const {
+    return rtm::transform_bounds(m_transform, local_bounds());
+  }
+
+  [[nodiscard]] virtual rtm::aabb<real> local_bounds() const = 0;
+
   [[nodiscard]] std::optional<rtm::intersects>
-  intersect(const rtm::ray<long double> &ray) {
-    auto local_ray = transform_ray(ray, m_inverse_transform);
+  intersect(const rtm::ray<real> &ray) const {
+    switch (m_classification) {
+    case transform_class::identity:
+      return local_intersect(ray);
+    case transform_class::translation:
+    case transform_class::uniform_scale:
+      return similar_intersect(ray);
+    case transform_class::general:
+      break;
+    }
+    return local_intersect(to_local(ray));
+  }
+
+  // World-space ray in the object's own coordinates
+  [[nodiscard]] constexpr rtm::ray<real>
+  to_local(const rtm::ray<real> &ray) const {
+    return rtm::transform_ray(m_inverse_transform, ray);
+  }
+
+  // The inverse-transpose of the transform's linear part, kept up to date by
+  // set_transform(); takes object-space normals to world space
+  [[nodiscard]] constexpr const rtm::matrix<3, 3, real> &normal_matrix() const {
+    return m_normal_matrix;
+  }
+
+  // Not normalized; w comes out 0
+  [[nodiscard]] constexpr rtm::vec4
+  normal_to_world(const rtm::vec4 &object_normal) const {
+    return rtm::apply_normal_matrix(m_normal_matrix, object_normal);
+  }
+
+  // Unit surface normal at a world-space point on the object
+  [[nodiscard]] rtm::vec4 normal_at(const rtm::vec4 &world_point) const {
+    const auto object_point = m_inverse_transform.transform_point(world_point);
+    return normalize(normal_to_world(local_normal_at(object_point)));
+  }
+
+  // W coherent rays at once, lanes are independent
+  template <size_t W>
+  [[nodiscard]] rtm::packet_intersects<W, real>
+  intersect_packet(const rtm::ray_packet<W, real> &packet) const {
+    auto local_packet = packet;
+    local_packet.transform(m_inverse_transform);
 
-    return local_intersect(local_ray);
+    return local_intersect_packet(local_packet);
   }
 
   constexpr void
-  set_transform(const rtm::matrix<4, 4, long double> &transform) {
+  set_transform(const rtm::matrix<4, 4, real> &transform) {
+    set_transform(rtm::affine<real>{transform});
+  }
+
+  constexpr void set_transform(const rtm::affine<real> &transform) {
     m_transform = transform;
-    m_inverse_transform = rtm::matrix_inverse(transform);
+    m_inverse_transform = rtm::affine_inverse(transform);
+    m_normal_matrix = rtm::normal_matrix(m_inverse_transform);
+    m_classification = rtm::classify(transform);
   }
 
 protected:
   [[nodiscard]] virtual constexpr std::optional<rtm::intersects>
-  local_intersect(const rtm::ray<long double> &local_ray) = 0;
+  local_intersect(const rtm::ray<real> &local_ray) const = 0;
 
-private:
-  rtm::matrix<4, 4, long double> m_transform{identity_matrix<4, long double>()};
-  rtm::matrix<4, 4, long double> m_inverse_transform{
-      identity_matrix<4, long double>()};
+  // intersect() for a translation or uniform scale, given the world-space
+  // ray; primitives with a closed form in world space override it
+  [[nodiscard]] virtual std::optional<rtm::intersects>
+  similar_intersect(const rtm::ray<real> &ray) const {
+    return local_intersect(to_local(ray));
+  }
+
+  // Normal at an object-space point on the surface, any length
+  [[nodiscard]] virtual rtm::vec4
+  local_normal_at(const rtm::vec4 &local_point) const = 0;
+
+  // Primitives with a vectorized kernel override these; the defaults run
+  // local_intersect() lane by lane
+  [[nodiscard]] virtual rtm::packet_intersects<4, real>
+  local_intersect_packet(const rtm::ray_packet<4, real> &local_packet) const {
+    return intersect_lanes(local_packet);
+  }
+
+  [[nodiscard]] virtual rtm::packet_intersects<8, real>
+  local_intersect_packet(const rtm::ray_packet<8, real> &local_packet) const {
+    return intersect_lanes(local_packet);
+  }
 
-  static rtm::ray<long double>
-  transform_ray(const rtm::ray<long double> &ray,
-                const rtm::matrix<4, 4, long double> &mat) {
-    return {.origin = mat * ray.origin, .direction = mat * ray.direction};
+  template <size_t W>
+  [[nodiscard]] rtm::packet_intersects<W, real>
+  intersect_lanes(const rtm::ray_packet<W, real> &local_packet) const {
+    using pack_type = simd::pack<real, W>;
+
+    std::array<real, W> t1{};
+    std::array<real, W> t2{};
+    typename pack_type::mask_type mask{};
+
+    for (size_t i = 0; i < W; ++i) {
+      if (const auto lane = local_intersect(local_packet.lane(i))) {
+        t1[i] = (*lane)[0].t;
+        t2[i] = (*lane)[1].t;
+        mask |= 1U << i;
+      }
+    }
+
+    return {pack_type::load(t1.data()), pack_type::load(t2.data()), mask,
+            this};
   }
+
+private:
+  // Only the built-in primitives may claim a built-in kind: visit_primitive()
+  // casts to the concrete type on the strength of it
+  friend class sphere;
+
+  constexpr explicit object(const primitive_kind kind) : m_kind{kind} {}
+
+  rtm::affine<real> m_transform{};
+  rtm::affine<real> m_inverse_transform{};
+  rtm::matrix<3, 3, real> m_normal_matrix{rtm::identity_matrix<3, real>()};
+  transform_class m_classification{transform_class::identity};
+  primitive_kind m_kind{primitive_kind::custom};
 };
+
+// Shared ownership of the object behind a hit, for code outside the per-ray
+// loop; empty if the object is not held by a shared_ptr
+[[nodiscard]] inline std::weak_ptr<const object>
+weak_handle(const rtm::intersect &inter) {
+  return inter.object ? inter.object->weak_from_this()
+                      : std::weak_ptr<const object>{};
+}
 } // namespace rtm
 
 #endif
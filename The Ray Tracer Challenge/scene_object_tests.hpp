@@ -2,7 +2,11 @@
 #define SCENE_OBJECT_TESTS_HPP
 
 #include "hit.hpp"
+#include "intersection_list.hpp"
+#include "light_grid.hpp"
+#include "light_set.hpp"
 #include "lighting.hpp"
+#include "primitive.hpp"
 #include "sphere.hpp"
 #include "test_helpers.hpp"
 
@@ -10,7 +14,7 @@ namespace rtm::testing {
 inline void perform_scene_tests() {
   // Ray intersect with sphere test
   {
-    rtm::ray<long double> some_ray{{0, 0, -5, 1}, {0, 0, 1, 0}};
+    rtm::ray<real> some_ray{{0, 0, -5, 1}, {0, 0, 1, 0}};
 
     auto some_sphere = rtm::sphere::make();
 
@@ -18,7 +22,7 @@ inline void perform_scene_tests() {
 
     std::pair ret_vals{some_intersect[0].t, some_intersect[1].t};
 
-    testing::expected(std::pair{4.L, 6.L}, ret_vals);
+    testing::expected(std::pair<real, real>{4, 6}, ret_vals);
 
     some_ray.origin = {0, 1, -5, 1};
 
@@ -34,7 +38,7 @@ inline void perform_scene_tests() {
 
     ret_vals = {some_intersect[0].t, some_intersect[1].t};
 
-    testing::expected(std::pair{-1.L, 1.L}, ret_vals);
+    testing::expected(std::pair<real, real>{-1, 1}, ret_vals);
 
     some_ray.origin = {0, 0, 5, 1};
 
@@ -42,16 +46,16 @@ inline void perform_scene_tests() {
 
     ret_vals = {some_intersect[0].t, some_intersect[1].t};
 
-    testing::expected(std::pair{-6.L, -4.L}, ret_vals);
+    testing::expected(std::pair<real, real>{-6, -4}, ret_vals);
   }
 
   {
     auto some_sphere = rtm::sphere::make();
 
-    rtm::intersect i1 = {5, some_sphere};
-    rtm::intersect i2 = {7, some_sphere};
-    rtm::intersect i3 = {-3, some_sphere};
-    rtm::intersect i4 = {2, some_sphere};
+    rtm::intersect i1 = {5, some_sphere.get()};
+    rtm::intersect i2 = {7, some_sphere.get()};
+    rtm::intersect i3 = {-3, some_sphere.get()};
+    rtm::intersect i4 = {2, some_sphere.get()};
 
     rtm::intersect out;
 
@@ -66,23 +70,62 @@ inline void perform_scene_tests() {
     testing::expected(i4.t, out.t);
   }
 
+  // Intersection lists keep the nearest non-negative hit as they fill, sort
+  // only on request, and spill past their inline capacity intact
+  {
+    intersection_list<rtm::intersect, 4> xs;
+    expected(false, hit(xs).has_value());
+
+    for (const real t : {5, -1, 7, 2, -3, 9})
+      xs.push_back({t, nullptr});
+
+    expected(size_t{6}, xs.size());
+    expected(true, xs.spilled());
+    expected(real{2}, hit(xs)->t);
+    expected(real{7}, xs[2].t);
+
+    std::vector<real> ts;
+    for (const auto &x : xs.sorted())
+      ts.push_back(x.t);
+    expected(true, ts == std::vector<real>{-3, -1, 2, 5, 7, 9});
+    expected(real{2}, xs.hit()->t);
+
+    xs.clear();
+    xs.append(std::array<rtm::intersect, 2>{{{-2, nullptr}, {-1, nullptr}}});
+    expected(false, xs.spilled());
+    expected(false, xs.hit().has_value());
+    expected(true, std::isinf(xs.nearest_t()));
+  }
+
+  // Hits refer to the object directly; ownership is recoverable on request
+  {
+    auto some_sphere = rtm::sphere::make();
+
+    const auto xs =
+        some_sphere->intersect({{0, 0, -5, 1}, {0, 0, 1, 0}}).value();
+
+    testing::expected(true, xs[0].object == some_sphere.get());
+    testing::expected(true, weak_handle(xs[0]).lock() == some_sphere);
+    testing::expected(true, weak_handle(rtm::intersect{}).expired());
+  }
+
   {
     auto some_ray =
-        rtm::ray<long double>{{1.L, 2.L, 3.L, 1.L}, {0.L, 1.L, 0.L, 0.L}};
+        rtm::ray<real>{{1, 2, 3, 1}, {0, 1, 0, 0}};
 
     auto some_mat = rtm::matrix_translate({3, 4, 5});
 
     some_ray.transform(some_mat);
 
     testing::expected(
-        rtm::ray<long double>{{4.L, 6.L, 8.L, 1.L}, {0.L, 1.L, 0.L, 0.L}},
+        rtm::ray<real>{{4, 6, 8, 1}, {0, 1, 0, 0}},
         some_ray);
   }
 
   {
     auto some_sphere = rtm::sphere::make();
 
-    testing::expected(identity_matrix<4, long double>(),
+    testing::expected(identity_matrix<4, real>(),
                       some_sphere->transform());
 
     auto some_translation = matrix_translate({2, 3, 4});
@@ -95,7 +138,7 @@ inline void perform_scene_tests() {
   {
     auto some_sphere = rtm::sphere::make();
     auto some_ray =
-        rtm::ray<long double>{{0.L, 0.L, -5.L, 1.L}, {0.L, 0.L, 1.L, 0.L}};
+        rtm::ray<real>{{0, 0, -5, 1}, {0, 0, 1, 0}};
 
     some_sphere->set_transform(matrix_scale({2, 2, 2}));
 
@@ -103,13 +146,13 @@ inline void perform_scene_tests() {
 
     std::pair some_results = {some_intersects[0].t, some_intersects[1].t};
 
-    testing::expected(std::pair{3.L, 7.L}, some_results);
+    testing::expected(std::pair<real, real>{3, 7}, some_results);
   }
 
   {
     auto some_sphere = rtm::sphere::make();
     auto some_ray =
-        rtm::ray<long double>{{0.L, 0.L, -5.L, 1.L}, {0.L, 0.L, 1.L, 0.L}};
+        rtm::ray<real>{{0, 0, -5, 1}, {0, 0, 1, 0}};
 
     some_sphere->set_transform(matrix_translate({5, 0, 0}));
 
@@ -161,6 +204,13 @@ inline void perform_scene_tests() {
 
     testing::expected(vec4{0, 0.970142500145, -0.242535625036, 0}, n);
 
+    // The cached normal matrix is the inverse-transpose of the linear part
+    testing::expected(
+        submatrix(matrix_transpose(matrix_inverse(
+                      some_sphere->transform().to_matrix())),
+                  3, 3),
+        some_sphere->normal_matrix());
+
     testing::expected(vec4{1, 1, 0, 0},
                       rtm::reflect(vec4{1, -1, 0, 0}, normal{0, 1, 0, 0}));
 
@@ -170,6 +220,160 @@ inline void perform_scene_tests() {
                      normal{c_sqrt(2.L) / 2, c_sqrt(2.L) / 2, 0, 0}));
   }
 
+  // Packets of 4 and 8 rays agree lane by lane with the scalar path,
+  // including misses and rays starting inside the sphere
+  {
+    auto some_sphere = rtm::sphere::make();
+    some_sphere->set_transform(matrix_translate({0.5, -0.25, 1}) *
+                               matrix_scale({2, 2, 2}));
+
+    std::array<rtm::ray<real>, 8> rays{};
+    for (size_t i = 0; i < rays.size(); ++i) {
+      const auto offset = static_cast<real>(i) - real{3.5};
+      rays[i] = {{offset * real{0.7}, real{0.25} * offset, -6, 1},
+                 normalize(vec4{-offset * real{0.05}, real{0.02}, 1, 0})};
+    }
+    rays[7].origin = {0.5, -0.25, 1, 1}; // centre of the sphere
+
+    const auto check = [&]<size_t W>(const std::span<const rtm::ray<real>, W>
+                                         lanes) {
+      const auto packet = rtm::ray_packet<W, real>::gather(lanes);
+      const auto packet_result = some_sphere->intersect_packet(packet);
+      const auto packet_closest = rtm::hit(packet_result);
+
+      for (size_t i = 0; i < W; ++i) {
+        const auto scalar_result = some_sphere->intersect(lanes[i]);
+        const bool lane_hit = (packet_result.mask >> i) & 1U;
+
+        testing::expected(scalar_result.has_value(), lane_hit);
+
+        if (!scalar_result.has_value())
+          continue;
+
+        testing::expected((*scalar_result)[0].t, packet_result.t1[i]);
+        testing::expected((*scalar_result)[1].t, packet_result.t2[i]);
+
+        const auto scalar_closest = rtm::hit(*scalar_result);
+        testing::expected(scalar_closest.has_value(),
+                          static_cast<bool>((packet_closest.mask >> i) & 1U));
+        if (scalar_closest.has_value())
+          testing::expected(scalar_closest->t, packet_closest.t[i]);
+      }
+    };
+
+    check(std::span<const rtm::ray<real>, 8>{rays});
+    check(std::span<const rtm::ray<real>, 4>{rays.data() + 4, 4});
+  }
+
+  // Spheres under a translation and uniform scale are hit from their centre
+  // and radius in world space, and agree with the general path
+  {
+    const auto transform =
+        matrix_translate<real>({1, -2, 3}) * matrix_scale<real>({2, 2, 2});
+
+    auto simple = rtm::sphere::make();
+    simple->set_transform(transform);
+    testing::expected(true, simple->simple());
+    testing::expected(vec<3, real>{1, -2, 3}, simple->shape().center);
+    testing::expected(real{4}, simple->shape().radius_squared);
+
+    // Rotating by a full turn is the same sphere the long way round
+    auto general = rtm::sphere::make();
+    general->set_transform(transform *
+                           matrix_rotate_z<real>(2 * constants::PI));
+    testing::expected(false, general->simple());
+
+    const rtm::ray<real> r{{1, -2, -5, 1},
+                           normalize(vec4{real{0.1}, real{0.05}, 1, 0})};
+    const auto fast = rtm::intersect_primitive(*simple, r);
+    const auto slow = rtm::intersect_primitive(*general, r);
+
+    testing::expected(true, fast.has_value() && slow.has_value());
+    testing::expected((*slow)[0].t, (*fast)[0].t);
+    testing::expected((*slow)[1].t, (*fast)[1].t);
+
+    // The virtual interface takes the same shortcut
+    const rtm::object &base = *simple;
+    const auto through_base = base.intersect(r);
+    testing::expected(true, through_base.has_value());
+    testing::expected((*fast)[0].t, (*through_base)[0].t);
+    testing::expected((*fast)[1].t, (*through_base)[1].t);
+
+    const vec4 point{3, -2, 3, 1};
+    testing::expected(rtm::normal_at(*general, point),
+                      rtm::normal_at(*simple, point));
+    testing::expected(vec4{1, 0, 0, 0}, rtm::normal_at(*simple, point));
+  }
+
+  // Static dispatch and type buckets agree with the virtual interface, and
+  // types outside the closed set still work through it
+  {
+    // Hits everything at t = 3 and 4, whatever the ray
+    class constant_object final : public object {
+    public:
+      [[nodiscard]] rtm::aabb<real> local_bounds() const override {
+        return {{-1, -1, -1}, {1, 1, 1}};
+      }
+
+    protected:
+      [[nodiscard]] std::optional<rtm::intersects>
+      local_intersect(const rtm::ray<real> &) const override {
+        return {{{{3, this}, {4, this}}}};
+      }
+
+      [[nodiscard]] vec4 local_normal_at(const vec4 &) const override {
+        return {0, 0, -2, 0};
+      }
+    };
+
+    std::vector<std::shared_ptr<object>> objects;
+    for (int i = 0; i < 4; ++i) {
+      auto s = rtm::sphere::make();
+      s->set_transform(matrix_translate<real>({0, 0, static_cast<real>(i)}));
+      objects.push_back(s);
+    }
+    objects.push_back(std::make_shared<constant_object>());
+
+    testing::expected(true, objects[0]->kind() == primitive_kind::sphere);
+    testing::expected(true, objects[4]->kind() == primitive_kind::custom);
+
+    const rtm::ray<real> r{{0, 0, -5, 1}, {0, 0, 1, 0}};
+    for (const auto &current : objects) {
+      const auto virtual_result = current->intersect(r).value();
+      const auto static_result = dispatch_intersect(*current, r).value();
+
+      testing::expected(virtual_result[0].t, static_result[0].t);
+      testing::expected(virtual_result[1].t, static_result[1].t);
+      testing::expected(true, static_result[0].object == current.get());
+    }
+
+    // Normals take the same static route, the custom object its override
+    objects[1]->set_transform(matrix_scale<real>({1, 0.5L, 1}) *
+                              matrix_rotate_z<real>(constants::PI / 5));
+    for (const auto &current : objects) {
+      const vec4 p{0.3L, 0.4L, -0.2L, 1};
+      testing::expected(current->normal_at(p), normal_at(*current, p));
+    }
+    testing::expected(normal{0, 0, -1, 0},
+                      normal_at(*objects[4], vec4{0, 0, 0, 1}));
+
+    const primitive_buckets buckets{objects};
+
+    testing::expected(size_t{4}, buckets.bucket<sphere>().size());
+    testing::expected(size_t{1}, buckets.bucket<object>().size());
+    testing::expected(objects.size(), buckets.size());
+
+    // The custom object at t = 3 is in front of the first sphere at t = 4
+    testing::expected(real{3}, buckets.closest_hit(r)->t);
+    testing::expected(true, buckets.closest_hit(r)->object == objects[4].get());
+
+    // Starting inside the third sphere, its far side is closest
+    const rtm::ray<real> inner_ray{{0, 0, 2.5L, 1}, {0, 0, 1, 0}};
+    testing::expected(real{0.5L}, buckets.closest_hit(inner_ray)->t);
+    testing::expected(true, buckets.closest_hit(inner_ray)->object ==
+                                objects[2].get());
+  }
+
   {
     material m{};
     vec4 eyev{0, 0, -1, 0};
@@ -197,6 +401,134 @@ inline void perform_scene_tests() {
     light.position = {0, 0, 10, 1};
     testing::expected(clr1{0.1, 0.1, 0.1},
                       lighting(m, light, vec4{0, 0, 0, 1}, eyev, normalv));
+
+    // Fractional shininess, through a material baked up front
+    m.shininess = 10.5L;
+    light.position = {0, 10, -10, 1};
+    const auto baked = bake_lighting(m, light);
+    const auto highlight = static_cast<real>(
+        0.736396103068L + 0.9L * std::pow(c_sqrt(0.5L), 10.5L));
+
+    testing::expected(clr1{highlight, highlight, highlight},
+                      lighting(baked, vec4{0, 0, 0, 1}, eyev, normalv));
+    testing::expected(lighting(m, light, vec4{0, 0, 0, 1}, eyev, normalv),
+                      lighting(baked, vec4{0, 0, 0, 1}, eyev, normalv));
+  }
+
+  // A light set shades like its lights one at a time, including lights
+  // behind the surface and a partial last pack
+  {
+    std::vector<point_light> lights;
+    for (int i = 0; i < 11; ++i) {
+      const auto k = static_cast<real>(i);
+      const real z = i % 3 == 0 ? 10 : -10;
+      lights.push_back({{static_cast<real>(i % 4) / 10, k / 20, 1 - k / 12},
+                        {k - 5, static_cast<real>(3.5L) - k, z, 1}});
+    }
+
+    const light_set set{lights};
+    testing::expected(size_t{11}, set.size());
+    testing::expected(lights[7].position, set[7].position);
+    testing::expected(lights[7].intensity, set[7].intensity);
+
+    const vec4 point{0.5L, -0.25L, 0, 1};
+    const normal n = normalize(vec4{0.2L, 0.3L, -1, 0});
+    const vec4 eyev = normalize(vec4{-0.1L, 0.4L, -1, 0});
+
+    for (const real shininess : {real{200}, real{10.5L}}) {
+      material m{};
+      m.color = {0.8L, 0.6L, 0.3L};
+      m.shininess = shininess;
+
+      clr1 one_by_one{0, 0, 0};
+      for (const auto &light : lights)
+        one_by_one += lighting(m, light, point, eyev, n);
+
+      testing::expected(one_by_one, lighting(m, set, point, eyev, n));
+    }
+
+    // No lights, no light
+    testing::expected(clr1{0, 0, 0},
+                      lighting(material{}, light_set{}, point, eyev, n));
+  }
+
+  // Lights fade out over their range
+  {
+    const material m{};
+    const vec4 eyev{0, 0, -1, 0};
+    const normal n{0, 0, -1, 0};
+    point_light light{{1, 1, 1}, {0, 0, -10, 1}, 20};
+
+    // (1 - (10 / 20)^4)^2 of diffuse and specular
+    const real window = (1 - real{0.0625L}) * (1 - real{0.0625L});
+    testing::expected(window, light_window(100, 1 / real{400}));
+    testing::expected(clr1{0.1L + 1.8L * window, 0.1L + 1.8L * window,
+                           0.1L + 1.8L * window},
+                      lighting(m, light, vec4{0, 0, 0, 1}, eyev, n));
+
+    light.range = 10;
+    testing::expected(clr1{0.1, 0.1, 0.1},
+                      lighting(m, light, vec4{0, 0, 0, 1}, eyev, n));
+  }
+
+  // Culling through the light grid changes nothing: lights missing from a
+  // point's cell are out of range of it
+  {
+    std::vector<point_light> lights;
+    uint64_t state = 7;
+    const auto next = [&state] {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      return static_cast<real>(state >> 40) / static_cast<real>(1ULL << 24);
+    };
+
+    for (int i = 0; i < 300; ++i)
+      lights.push_back({{next(), next(), next()},
+                        {next() * 60 - 30, next() * 20 - 10, next() * 60 - 30,
+                         1},
+                        1 + next() * 4});
+    lights.push_back({{0.2L, 0.2L, 0.2L}, {0, 50, 0, 1}});
+    lights[5].range = 0;
+
+    const light_set set{lights};
+    const light_grid grid{set};
+    material m{};
+    m.shininess = 30;
+    const auto baked = bake_lighting(m, set);
+
+    size_t mismatches = 0;
+    size_t evaluated = 0;
+    for (int i = 0; i < 200; ++i) {
+      const vec4 point{next() * 70 - 35, next() * 24 - 12, next() * 70 - 35,
+                       1};
+      const real half{0.5L};
+      const normal n = normalize(vec4{next() - half, 1, next() - half, 0});
+      const vec4 eyev = normalize(vec4{next() - half, 1, next() - half, 0});
+
+      const auto near = grid.lights_near(point);
+      evaluated += near.size();
+      if (lighting(baked, near, point, eyev, n) !=
+          lighting(baked, point, eyev, n))
+        ++mismatches;
+    }
+
+    testing::expected(size_t{0}, mismatches);
+    // Far fewer than every light at every point
+    testing::expected(true, evaluated < 200 * lights.size() / 4);
+
+    // Outside the grid only the unbounded light is left
+    const auto outside = grid.lights_near(vec4{0, 500, 0, 1});
+    testing::expected(size_t{1}, outside.size());
+    testing::expected(uint32_t{300}, outside[0]);
+    testing::expected(true, outside.local.empty());
+
+    // Cells do not copy the unbounded lights; every query shares one run
+    testing::expected(true, grid.lights_near(vec4{1, 0, 1, 1}).everywhere.data() ==
+                                outside.everywhere.data());
+
+    // Without bounded lights the grid is just the unbounded ones
+    const light_grid unbounded{light_set{std::span{lights}.subspan(300)}};
+    testing::expected(size_t{1},
+                      unbounded.lights_near(vec4{1, 2, 3, 1}).size());
   }
 }
 } // namespace rtm::testing
@@ -0,0 +1,73 @@
+#ifndef SHADOW_HPP
+#define SHADOW_HPP
+
+#include "bvh.hpp"
+#include "lighting.hpp"
+#include "primitive.hpp"
+#include "ray.hpp"
+#include "scene_object.hpp"
+#include "sphere.hpp"
+#include "vec.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace rtm {
+// For each light, the object that last blocked it. Neighbouring shading
+// points mostly share their occluder, so trying it first settles most
+// shadowed points with one intersection test. Not thread safe, keep one per
+// thread; the pointers refer into the scene, so clear() when it changes.
+class occluder_cache {
+public:
+  occluder_cache() = default;
+
+  explicit occluder_cache(const size_t light_count)
+      : m_last(light_count, nullptr) {}
+
+  // The slot for light, created empty on first use
+  [[nodiscard]] const object *&operator[](const size_t light) {
+    if (light >= m_last.size())
+      m_last.resize(light + 1, nullptr);
+    return m_last[light];
+  }
+
+  void clear() noexcept { std::ranges::fill(m_last, nullptr); }
+
+private:
+  std::vector<const object *> m_last{};
+};
+
+// A surface point nudged off the surface along its normal, the book's
+// over_point. Shadow rays must start here rather than at the hit itself.
+[[nodiscard]] inline vec4 over_point(const vec4 &point, const normal &n) {
+  return point + n * constants::EPSILON_V<real>;
+}
+
+// Whether anything in scene lies between point and the light. The shadow
+// ray runs from point to the light's position unnormalized, so the light
+// sits at t = 1 and the distance is never computed. Every t >= 0 counts as
+// a blocker, so a point on a surface must already be pushed off it with
+// over_point(); straight off a hit it would often shadow itself (acne).
+// last_occluder is tried before the hierarchy and updated with whatever
+// blocks the light.
+[[nodiscard]] inline bool is_shadowed(const bvh &scene, const vec4 &point,
+                                      const point_light &light,
+                                      const object *&last_occluder) {
+  const ray<real> shadow_ray{point, light.position - point};
+
+  if (last_occluder && occludes(*last_occluder, shadow_ray, 1))
+    return true;
+
+  const object *occluder = scene.any_hit(shadow_ray, 1);
+  if (occluder)
+    last_occluder = occluder;
+  return occluder != nullptr;
+}
+
+[[nodiscard]] inline bool is_shadowed(const bvh &scene, const vec4 &point,
+                                      const point_light &light) {
+  const object *no_cache = nullptr;
+  return is_shadowed(scene, point, light, no_cache);
+}
+} // namespace rtm
+
+#endif
@@ -0,0 +1,331 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstddef>
+#include <type_traits>
+
+// Instruction set selection happens at compile time from what the compiler
+// targets (/arch:AVX, -mavx, ...). Define RTM_NO_SIMD to force the scalar
+// paths everywhere. The kernels cover float and double only: in the default
+// long double build (see rtm::real) the hot loops stay scalar, so the vector
+// speed-up needs RTM_PRECISION_DOUBLE or RTM_PRECISION_FLOAT.
+#if !defined(RTM_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RTM_SIMD_SSE2 1
+#endif
+#if defined(RTM_SIMD_SSE2) && defined(__AVX__)
+#define RTM_SIMD_AVX 1
+#endif
+#endif
+
+#if defined(RTM_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(RTM_SIMD_AVX)
+#include <immintrin.h>
+#endif
+
+namespace rtm::simd {
+// Whether N contiguous values of T have vector kernels on this target
+template <typename T, size_t N>
+inline constexpr bool accelerated_v =
+#if defined(RTM_SIMD_SSE2)
+    N == 4 && (std::is_same_v<T, float> || std::is_same_v<T, double>);
+#else
+    false;
+#endif
+
+// Alignment for a run of N values of T: one full register when accelerated
+template <typename T, size_t N>
+inline constexpr size_t alignment_v =
+    accelerated_v<T, N> ? sizeof(T) * N : alignof(T);
+
+#if defined(RTM_SIMD_SSE2)
+namespace detail {
+// 4 x float
+using f4 = __m128;
+
+inline f4 load(const float *p) noexcept { return _mm_loadu_ps(p); }
+inline void store(float *p, const f4 v) noexcept { _mm_storeu_ps(p, v); }
+inline f4 broadcast(const float s) noexcept { return _mm_set1_ps(s); }
+inline f4 add(const f4 a, const f4 b) noexcept { return _mm_add_ps(a, b); }
+inline f4 sub(const f4 a, const f4 b) noexcept { return _mm_sub_ps(a, b); }
+inline f4 mul(const f4 a, const f4 b) noexcept { return _mm_mul_ps(a, b); }
+inline f4 div(const f4 a, const f4 b) noexcept { return _mm_div_ps(a, b); }
+inline f4 negate(const f4 a) noexcept {
+  return _mm_xor_ps(a, _mm_set1_ps(-0.f));
+}
+
+inline void transpose(f4 &r0, f4 &r1, f4 &r2, f4 &r3) noexcept {
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+}
+
+// Sum of the four lanes, reduced in registers in the scalar loop's order:
+// (((0 + l0) + l1) + l2) + l3
+inline float horizontal_sum(const f4 a) noexcept {
+  f4 sum = _mm_add_ss(_mm_setzero_ps(), a);
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)));
+  sum = _mm_add_ss(sum, _mm_movehl_ps(a, a));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)));
+  return _mm_cvtss_f32(sum);
+}
+
+// Sum of lo[0], lo[1], hi[0], hi[1], in that order, starting from zero
+inline double horizontal_sum(const __m128d lo, const __m128d hi) noexcept {
+  __m128d sum = _mm_add_sd(_mm_setzero_pd(), lo);
+  sum = _mm_add_sd(sum, _mm_unpackhi_pd(lo, lo));
+  sum = _mm_add_sd(sum, hi);
+  sum = _mm_add_sd(sum, _mm_unpackhi_pd(hi, hi));
+  return _mm_cvtsd_f64(sum);
+}
+
+// 4 x double
+#if defined(RTM_SIMD_AVX)
+using d4 = __m256d;
+
+inline d4 load(const double *p) noexcept { return _mm256_loadu_pd(p); }
+inline void store(double *p, const d4 v) noexcept { _mm256_storeu_pd(p, v); }
+inline d4 broadcast(const double s) noexcept { return _mm256_set1_pd(s); }
+inline d4 add(const d4 a, const d4 b) noexcept { return _mm256_add_pd(a, b); }
+inline d4 sub(const d4 a, const d4 b) noexcept { return _mm256_sub_pd(a, b); }
+inline d4 mul(const d4 a, const d4 b) noexcept { return _mm256_mul_pd(a, b); }
+inline d4 div(const d4 a, const d4 b) noexcept { return _mm256_div_pd(a, b); }
+inline d4 negate(const d4 a) noexcept {
+  return _mm256_xor_pd(a, _mm256_set1_pd(-0.));
+}
+
+inline void transpose(d4 &r0, d4 &r1, d4 &r2, d4 &r3) noexcept {
+  const d4 t0 = _mm256_unpacklo_pd(r0, r1);
+  const d4 t1 = _mm256_unpackhi_pd(r0, r1);
+  const d4 t2 = _mm256_unpacklo_pd(r2, r3);
+  const d4 t3 = _mm256_unpackhi_pd(r2, r3);
+
+  r0 = _mm256_permute2f128_pd(t0, t2, 0x20);
+  r1 = _mm256_permute2f128_pd(t1, t3, 0x20);
+  r2 = _mm256_permute2f128_pd(t0, t2, 0x31);
+  r3 = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+inline double horizontal_sum(const d4 a) noexcept {
+  return horizontal_sum(_mm256_castpd256_pd128(a),
+                        _mm256_extractf128_pd(a, 1));
+}
+#else
+// SSE2 only: a pair of 2-wide registers
+struct d4 {
+  __m128d lo;
+  __m128d hi;
+};
+
+inline d4 load(const double *p) noexcept {
+  return {_mm_loadu_pd(p), _mm_loadu_pd(p + 2)};
+}
+inline void store(double *p, const d4 v) noexcept {
+  _mm_storeu_pd(p, v.lo);
+  _mm_storeu_pd(p + 2, v.hi);
+}
+inline d4 broadcast(const double s) noexcept {
+  return {_mm_set1_pd(s), _mm_set1_pd(s)};
+}
+inline d4 add(const d4 a, const d4 b) noexcept {
+  return {_mm_add_pd(a.lo, b.lo), _mm_add_pd(a.hi, b.hi)};
+}
+inline d4 sub(const d4 a, const d4 b) noexcept {
+  return {_mm_sub_pd(a.lo, b.lo), _mm_sub_pd(a.hi, b.hi)};
+}
+inline d4 mul(const d4 a, const d4 b) noexcept {
+  return {_mm_mul_pd(a.lo, b.lo), _mm_mul_pd(a.hi, b.hi)};
+}
+inline d4 div(const d4 a, const d4 b) noexcept {
+  return {_mm_div_pd(a.lo, b.lo), _mm_div_pd(a.hi, b.hi)};
+}
+inline d4 negate(const d4 a) noexcept {
+  const __m128d sign = _mm_set1_pd(-0.);
+  return {_mm_xor_pd(a.lo, sign), _mm_xor_pd(a.hi, sign)};
+}
+
+inline double horizontal_sum(const d4 a) noexcept {
+  return horizontal_sum(a.lo, a.hi);
+}
+
+inline void transpose(d4 &r0, d4 &r1, d4 &r2, d4 &r3) noexcept {
+  const d4 c0{_mm_unpacklo_pd(r0.lo, r1.lo), _mm_unpacklo_pd(r2.lo, r3.lo)};
+  const d4 c1{_mm_unpackhi_pd(r0.lo, r1.lo), _mm_unpackhi_pd(r2.lo, r3.lo)};
+  const d4 c2{_mm_unpacklo_pd(r0.hi, r1.hi), _mm_unpacklo_pd(r2.hi, r3.hi)};
+  const d4 c3{_mm_unpackhi_pd(r0.hi, r1.hi), _mm_unpackhi_pd(r2.hi, r3.hi)};
+
+  r0 = c0;
+  r1 = c1;
+  r2 = c2;
+  r3 = c3;
+}
+#endif
+} // namespace detail
+
+// Kernels over 4 contiguous values. The reductions keep the summation order
+// of the scalar loops they replace, so both paths produce the same bits.
+
+template <typename T> inline void add(T *lhs, const T *rhs) noexcept {
+  detail::store(lhs, detail::add(detail::load(lhs), detail::load(rhs)));
+}
+
+template <typename T> inline void sub(T *lhs, const T *rhs) noexcept {
+  detail::store(lhs, detail::sub(detail::load(lhs), detail::load(rhs)));
+}
+
+template <typename T> inline void mul(T *lhs, const T *rhs) noexcept {
+  detail::store(lhs, detail::mul(detail::load(lhs), detail::load(rhs)));
+}
+
+template <typename T> inline void div(T *lhs, const T *rhs) noexcept {
+  detail::store(lhs, detail::div(detail::load(lhs), detail::load(rhs)));
+}
+
+template <typename T> inline void add(T *lhs, const T scalar) noexcept {
+  detail::store(lhs, detail::add(detail::load(lhs), detail::broadcast(scalar)));
+}
+
+template <typename T> inline void sub(T *lhs, const T scalar) noexcept {
+  detail::store(lhs, detail::sub(detail::load(lhs), detail::broadcast(scalar)));
+}
+
+template <typename T> inline void mul(T *lhs, const T scalar) noexcept {
+  detail::store(lhs, detail::mul(detail::load(lhs), detail::broadcast(scalar)));
+}
+
+template <typename T> inline void div(T *lhs, const T scalar) noexcept {
+  detail::store(lhs, detail::div(detail::load(lhs), detail::broadcast(scalar)));
+}
+
+template <typename T> inline void negate(T *lhs) noexcept {
+  detail::store(lhs, detail::negate(detail::load(lhs)));
+}
+
+template <typename T> inline T dot(const T *a, const T *b) noexcept {
+  return detail::horizontal_sum(
+      detail::mul(detail::load(a), detail::load(b)));
+}
+
+// out = m * v for a row-major 4x4 m; out may alias v
+template <typename T>
+inline void mat4_mul_vec4(const T *m, const T *v, T *out) noexcept {
+  const auto column = detail::load(v);
+
+  auto p0 = detail::mul(detail::load(m), column);
+  auto p1 = detail::mul(detail::load(m + 4), column);
+  auto p2 = detail::mul(detail::load(m + 8), column);
+  auto p3 = detail::mul(detail::load(m + 12), column);
+
+  // Lane r of pk now holds m(r, k) * v[k]
+  detail::transpose(p0, p1, p2, p3);
+
+  auto sum = detail::add(detail::broadcast(T{}), p0);
+  sum = detail::add(sum, p1);
+  sum = detail::add(sum, p2);
+  sum = detail::add(sum, p3);
+
+  detail::store(out, sum);
+}
+
+// out = a * b for row-major 4x4 matrices; out may alias a or b
+template <typename T>
+inline void mat4_mul_mat4(const T *a, const T *b, T *out) noexcept {
+  const auto b0 = detail::load(b);
+  const auto b1 = detail::load(b + 4);
+  const auto b2 = detail::load(b + 8);
+  const auto b3 = detail::load(b + 12);
+
+  for (size_t r = 0; r < 4; ++r) {
+    const T *row = a + r * 4;
+
+    auto sum = detail::add(detail::broadcast(T{}),
+                           detail::mul(detail::broadcast(row[0]), b0));
+    sum = detail::add(sum, detail::mul(detail::broadcast(row[1]), b1));
+    sum = detail::add(sum, detail::mul(detail::broadcast(row[2]), b2));
+    sum = detail::add(sum, detail::mul(detail::broadcast(row[3]), b3));
+
+    detail::store(out + r * 4, sum);
+  }
+}
+#else
+// No vector unit: accelerated_v is false everywhere, so these are never
+// picked; they keep the call sites well-formed.
+template <typename T> inline void add(T *lhs, const T *rhs) noexcept {
+  for (size_t i = 0; i < 4; ++i)
+    lhs[i] += rhs[i];
+}
+
+template <typename T> inline void sub(T *lhs, const T *rhs) noexcept {
+  for (size_t i = 0; i < 4; ++i)
+    lhs[i] -= rhs[i];
+}
+
+template <typename T> inline void mul(T *lhs, const T *rhs) noexcept {
+  for (size_t i = 0; i < 4; ++i)
+    lhs[i] *= rhs[i];
+}
+
+template <typename T> inline void div(T *lhs, const T *rhs) noexcept {
+  for (size_t i = 0; i < 4; ++i)
+    lhs[i] /= rhs[i];
+}
+
+template <typename T> inline void add(T *lhs, const T scalar) noexcept {
+  for (size_t i = 0; i < 4; ++i)
+    lhs[i] += scalar;
+}
+
+template <typename T> inline void sub(T *lhs, const T scalar) noexcept {
+  for (size_t i = 0; i < 4; ++i)
+    lhs[i] -= scalar;
+}
+
+template <typename T> inline void mul(T *lhs, const T scalar) noexcept {
+  for (size_t i = 0; i < 4; ++i)
+    lhs[i] *= scalar;
+}
+
+template <typename T> inline void div(T *lhs, const T scalar) noexcept {
+  for (size_t i = 0; i < 4; ++i)
+    lhs[i] /= scalar;
+}
+
+template <typename T> inline void negate(T *lhs) noexcept {
+  for (size_t i = 0; i < 4; ++i)
+    lhs[i] = -lhs[i];
+}
+
+template <typename T> inline T dot(const T *a, const T *b) noexcept {
+  T sum{};
+  for (size_t i = 0; i < 4; ++i)
+    sum += a[i] * b[i];
+  return sum;
+}
+
+template <typename T>
+inline void mat4_mul_vec4(const T *m, const T *v, T *out) noexcept {
+  T sum[4]{};
+  for (size_t r = 0; r < 4; ++r)
+    for (size_t c = 0; c < 4; ++c)
+      sum[r] += m[r * 4 + c] * v[c];
+
+  for (size_t r = 0; r < 4; ++r)
+    out[r] = sum[r];
+}
+
+template <typename T>
+inline void mat4_mul_mat4(const T *a, const T *b, T *out) noexcept {
+  T product[16]{};
+  for (size_t r = 0; r < 4; ++r)
+    for (size_t c = 0; c < 4; ++c)
+      for (size_t k = 0; k < 4; ++k)
+        product[r * 4 + c] += a[r * 4 + k] * b[k * 4 + c];
+
+  for (size_t i = 0; i < 16; ++i)
+    out[i] = product[i];
+}
+#endif
+} // namespace rtm::simd
+
+#endif
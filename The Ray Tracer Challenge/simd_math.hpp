@@ -0,0 +1,187 @@
+#ifndef SIMD_MATH_HPP
+#define SIMD_MATH_HPP
+
+#include "math_utils.hpp"
+#include "simd_pack.hpp"
+#include <array>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+namespace rtm::simd {
+// Lanes per step of the batch functions: the widest native pack of T, 4
+// where there is none
+template <std::floating_point T>
+inline constexpr size_t batch_width_v{detail::native<T, 8>::value ? 8 : 4};
+
+namespace detail {
+// Rounds every lane to the nearest integer by pushing it through a magnitude
+// where T has no fraction bits left. Exact while |x| < 2^(digits - 2).
+template <typename T, size_t W>
+[[nodiscard]] pack<T, W> round_nearest(const pack<T, W> &x) noexcept {
+  constexpr T shift{T{1.5} * power(T{2}, std::numeric_limits<T>::digits - 1)};
+  const auto magic = pack<T, W>::broadcast(shift);
+
+  return (x + magic) - magic;
+}
+
+// Taylor coefficients of sin(r) / r and cos(r) in powers of r^2. Nine terms
+// keep the truncation error under 1e-12 on [-pi/2, pi/2].
+inline constexpr size_t SINCOS_TERMS{9};
+
+template <typename T>
+inline constexpr std::array<T, SINCOS_TERMS> SIN_COEFFICIENTS{[] {
+  std::array<T, SINCOS_TERMS> c{};
+  for (size_t k = 0; k < SINCOS_TERMS; ++k)
+    c[k] = (k % 2 ? T{-1} : T{1}) / factorial<T>(static_cast<int>(2 * k + 1));
+  return c;
+}()};
+
+template <typename T>
+inline constexpr std::array<T, SINCOS_TERMS> COS_COEFFICIENTS{[] {
+  std::array<T, SINCOS_TERMS> c{};
+  for (size_t k = 0; k < SINCOS_TERMS; ++k)
+    c[k] = (k % 2 ? T{-1} : T{1}) / factorial<T>(static_cast<int>(2 * k));
+  return c;
+}()};
+
+template <typename T, size_t W>
+[[nodiscard]] pack<T, W>
+horner(const pack<T, W> &x,
+       const std::array<T, SINCOS_TERMS> &coefficients) noexcept {
+  auto result = pack<T, W>::broadcast(coefficients[SINCOS_TERMS - 1]);
+  for (size_t k = SINCOS_TERMS - 1; k-- > 0;)
+    result = result * x + pack<T, W>::broadcast(coefficients[k]);
+  return result;
+}
+
+inline void check_batch_sizes(const size_t in, const size_t out) {
+  if (in != out)
+    throw std::invalid_argument("batch: output size does not match the input");
+}
+} // namespace detail
+
+// Sine and cosine of every lane, branch-free. x is reduced to n * pi + r
+// with r in [-pi/2, pi/2], pi split in two so the reduction keeps its
+// precision for the angles a scene deals in; accuracy falls off once |x|
+// runs into the thousands.
+template <typename T, size_t W>
+void sincos(const pack<T, W> &x, pack<T, W> &sine,
+            pack<T, W> &cosine) noexcept {
+  using pack_type = pack<T, W>;
+
+  constexpr T pi_high{static_cast<T>(constants::PI)};
+  constexpr T pi_low{static_cast<T>(constants::PI - pi_high)};
+
+  const auto one = pack_type::broadcast(1);
+  const auto two = pack_type::broadcast(2);
+
+  const auto n = detail::round_nearest(
+      x * pack_type::broadcast(static_cast<T>(1 / constants::PI)));
+  const auto r = (x - n * pack_type::broadcast(pi_high)) -
+                 n * pack_type::broadcast(pi_low);
+
+  // (-1)^n from the parity of n, which is 0 or +-1
+  const auto parity =
+      n - two * detail::round_nearest(n * pack_type::broadcast(T{0.5}));
+  const auto sign = one - two * parity * parity;
+
+  const auto r2 = r * r;
+  sine = sign * r * detail::horner(r2, detail::SIN_COEFFICIENTS<T>);
+  cosine = sign * detail::horner(r2, detail::COS_COEFFICIENTS<T>);
+}
+
+// Every lane to a whole power, by squaring
+template <typename T, size_t W>
+[[nodiscard]] pack<T, W> power(pack<T, W> base, const int exp) noexcept {
+  const bool negative = exp < 0;
+  auto remaining = negative ? 0U - static_cast<unsigned>(exp)
+                            : static_cast<unsigned>(exp);
+
+  auto result = pack<T, W>::broadcast(1);
+  while (remaining != 0) {
+    if (remaining & 1U)
+      result = result * base;
+    base = base * base;
+    remaining >>= 1;
+  }
+  return negative ? pack<T, W>::broadcast(1) / result : result;
+}
+
+// fixed_power lane-wise: whole exponents stay in registers, any other runs
+// the scalar exp2/log2 path lane by lane
+template <typename T, size_t W>
+[[nodiscard]] pack<T, W> power(const pack<T, W> &base,
+                               const fixed_power<T> &exponent) noexcept {
+  if (exponent.integral())
+    return power(base, exponent.integer());
+
+  alignas(alignment_v<T, W>) std::array<T, W> lanes;
+  base.store(lanes.data());
+  for (auto &lane : lanes)
+    lane = exponent(lane);
+  return pack<T, W>::load(lanes.data());
+}
+
+// Batch variants over structure-of-arrays data, out[i] = f(in[i]). Full
+// packs of batch_width_v<T> lanes go through the vector kernels and the tail
+// through the scalar c_* functions. in and out may be the same array; sizes
+// that differ throw std::invalid_argument.
+
+template <std::floating_point T>
+void batch_sqrt(const std::type_identity_t<std::span<const T>> in,
+                const std::type_identity_t<std::span<T>> out) {
+  constexpr size_t width{batch_width_v<T>};
+  using pack_type = pack<T, width>;
+
+  detail::check_batch_sizes(in.size(), out.size());
+
+  size_t i = 0;
+  for (; i + width <= in.size(); i += width)
+    sqrt(pack_type::load(in.data() + i)).store(out.data() + i);
+  for (; i < in.size(); ++i)
+    out[i] = c_sqrt(in[i]);
+}
+
+template <std::floating_point T>
+void batch_rsqrt(const std::type_identity_t<std::span<const T>> in,
+                 const std::type_identity_t<std::span<T>> out) {
+  constexpr size_t width{batch_width_v<T>};
+  using pack_type = pack<T, width>;
+
+  detail::check_batch_sizes(in.size(), out.size());
+
+  size_t i = 0;
+  for (; i + width <= in.size(); i += width)
+    rsqrt(pack_type::load(in.data() + i)).store(out.data() + i);
+  for (; i < in.size(); ++i)
+    out[i] = T{1} / c_sqrt(in[i]);
+}
+
+template <std::floating_point T>
+void batch_sincos(const std::type_identity_t<std::span<const T>> in,
+                  const std::type_identity_t<std::span<T>> sine,
+                  const std::type_identity_t<std::span<T>> cosine) {
+  constexpr size_t width{batch_width_v<T>};
+  using pack_type = pack<T, width>;
+
+  detail::check_batch_sizes(in.size(), sine.size());
+  detail::check_batch_sizes(in.size(), cosine.size());
+
+  size_t i = 0;
+  for (; i + width <= in.size(); i += width) {
+    pack_type s, c;
+    sincos(pack_type::load(in.data() + i), s, c);
+    s.store(sine.data() + i);
+    c.store(cosine.data() + i);
+  }
+  for (; i < in.size(); ++i) {
+    // Read before writing; in may alias either output
+    const T x = in[i];
+    sine[i] = c_sin(x);
+    cosine[i] = c_cos(x);
+  }
+}
+} // namespace rtm::simd
+
+#endif
@@ -0,0 +1,451 @@
+#ifndef SIMD_PACK_HPP
+#define SIMD_PACK_HPP
+
+#include "simd.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <type_traits>
+
+namespace rtm::simd {
+namespace detail {
+// Register type backing W lanes of T, if the target has one; storage is what
+// a pack keeps either way
+template <typename T, size_t W> struct native {
+  using type = void;
+  using storage = std::array<T, W>;
+  static constexpr bool value{false};
+};
+} // namespace detail
+
+#if defined(RTM_SIMD_SSE2)
+namespace detail {
+// Lane-wise extras the packet kernels need on top of simd.hpp. Comparison
+// results are full-width lane masks in the same register type.
+
+inline f4 sqrt(const f4 a) noexcept { return _mm_sqrt_ps(a); }
+// The 12-bit estimate refined by one Newton step, y * (1.5 - a / 2 * y * y),
+// which is good to about 22 bits. Lanes where the step breaks down (0 and
+// infinity) keep the estimate, which is already exact there.
+inline f4 rsqrt(const f4 a) noexcept {
+  const f4 y = _mm_rsqrt_ps(a);
+  const f4 half_a = _mm_mul_ps(_mm_set1_ps(0.5f), a);
+  const f4 refined = _mm_mul_ps(
+      y, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(half_a, _mm_mul_ps(y, y))));
+  const f4 broken = _mm_cmpunord_ps(refined, refined);
+  return _mm_or_ps(_mm_and_ps(broken, y), _mm_andnot_ps(broken, refined));
+}
+inline f4 min(const f4 a, const f4 b) noexcept { return _mm_min_ps(a, b); }
+inline f4 max(const f4 a, const f4 b) noexcept { return _mm_max_ps(a, b); }
+inline f4 less(const f4 a, const f4 b) noexcept { return _mm_cmplt_ps(a, b); }
+inline f4 less_equal(const f4 a, const f4 b) noexcept {
+  return _mm_cmple_ps(a, b);
+}
+inline f4 bit_and(const f4 a, const f4 b) noexcept { return _mm_and_ps(a, b); }
+inline f4 bit_or(const f4 a, const f4 b) noexcept { return _mm_or_ps(a, b); }
+inline f4 bit_andnot(const f4 a, const f4 b) noexcept {
+  return _mm_andnot_ps(a, b);
+}
+inline uint32_t movemask(const f4 a) noexcept {
+  return static_cast<uint32_t>(_mm_movemask_ps(a));
+}
+inline f4 from_bits(const uint32_t bits, const f4 *) noexcept {
+  const __m128i lane_bits = _mm_set_epi32(8, 4, 2, 1);
+  const __m128i selected =
+      _mm_and_si128(_mm_set1_epi32(static_cast<int>(bits)), lane_bits);
+  return _mm_castsi128_ps(_mm_cmpeq_epi32(selected, lane_bits));
+}
+
+#if defined(RTM_SIMD_AVX)
+using f8 = __m256;
+
+inline f8 load(const float *p, const f8 *) noexcept {
+  return _mm256_loadu_ps(p);
+}
+inline void store(float *p, const f8 v) noexcept { _mm256_storeu_ps(p, v); }
+inline f8 broadcast(const float s, const f8 *) noexcept {
+  return _mm256_set1_ps(s);
+}
+inline f8 add(const f8 a, const f8 b) noexcept { return _mm256_add_ps(a, b); }
+inline f8 sub(const f8 a, const f8 b) noexcept { return _mm256_sub_ps(a, b); }
+inline f8 mul(const f8 a, const f8 b) noexcept { return _mm256_mul_ps(a, b); }
+inline f8 div(const f8 a, const f8 b) noexcept { return _mm256_div_ps(a, b); }
+inline f8 negate(const f8 a) noexcept {
+  return _mm256_xor_ps(a, _mm256_set1_ps(-0.f));
+}
+inline f8 sqrt(const f8 a) noexcept { return _mm256_sqrt_ps(a); }
+inline f8 rsqrt(const f8 a) noexcept {
+  const f8 y = _mm256_rsqrt_ps(a);
+  const f8 half_a = _mm256_mul_ps(_mm256_set1_ps(0.5f), a);
+  const f8 refined = _mm256_mul_ps(
+      y, _mm256_sub_ps(_mm256_set1_ps(1.5f),
+                       _mm256_mul_ps(half_a, _mm256_mul_ps(y, y))));
+  return _mm256_blendv_ps(refined, y,
+                          _mm256_cmp_ps(refined, refined, _CMP_UNORD_Q));
+}
+inline f8 min(const f8 a, const f8 b) noexcept { return _mm256_min_ps(a, b); }
+inline f8 max(const f8 a, const f8 b) noexcept { return _mm256_max_ps(a, b); }
+inline f8 less(const f8 a, const f8 b) noexcept {
+  return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+}
+inline f8 less_equal(const f8 a, const f8 b) noexcept {
+  return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+}
+inline f8 bit_and(const f8 a, const f8 b) noexcept {
+  return _mm256_and_ps(a, b);
+}
+inline f8 bit_or(const f8 a, const f8 b) noexcept { return _mm256_or_ps(a, b); }
+inline f8 bit_andnot(const f8 a, const f8 b) noexcept {
+  return _mm256_andnot_ps(a, b);
+}
+inline uint32_t movemask(const f8 a) noexcept {
+  return static_cast<uint32_t>(_mm256_movemask_ps(a));
+}
+inline f8 from_bits(const uint32_t bits, const f8 *) noexcept {
+  const f4 *tag = nullptr;
+  return _mm256_set_m128(from_bits(bits >> 4, tag), from_bits(bits, tag));
+}
+
+inline d4 sqrt(const d4 a) noexcept { return _mm256_sqrt_pd(a); }
+inline d4 min(const d4 a, const d4 b) noexcept { return _mm256_min_pd(a, b); }
+inline d4 max(const d4 a, const d4 b) noexcept { return _mm256_max_pd(a, b); }
+inline d4 less(const d4 a, const d4 b) noexcept {
+  return _mm256_cmp_pd(a, b, _CMP_LT_OQ);
+}
+inline d4 less_equal(const d4 a, const d4 b) noexcept {
+  return _mm256_cmp_pd(a, b, _CMP_LE_OQ);
+}
+inline d4 bit_and(const d4 a, const d4 b) noexcept {
+  return _mm256_and_pd(a, b);
+}
+inline d4 bit_or(const d4 a, const d4 b) noexcept { return _mm256_or_pd(a, b); }
+inline d4 bit_andnot(const d4 a, const d4 b) noexcept {
+  return _mm256_andnot_pd(a, b);
+}
+inline uint32_t movemask(const d4 a) noexcept {
+  return static_cast<uint32_t>(_mm256_movemask_pd(a));
+}
+inline d4 from_bits(const uint32_t bits, const d4 *) noexcept {
+  // No 256-bit integer compare before AVX2; build the lanes directly
+  return _mm256_castsi256_pd(_mm256_set_epi64x(
+      -static_cast<long long>((bits >> 3) & 1U),
+      -static_cast<long long>((bits >> 2) & 1U),
+      -static_cast<long long>((bits >> 1) & 1U),
+      -static_cast<long long>(bits & 1U)));
+}
+#else
+inline d4 sqrt(const d4 a) noexcept {
+  return {_mm_sqrt_pd(a.lo), _mm_sqrt_pd(a.hi)};
+}
+inline d4 min(const d4 a, const d4 b) noexcept {
+  return {_mm_min_pd(a.lo, b.lo), _mm_min_pd(a.hi, b.hi)};
+}
+inline d4 max(const d4 a, const d4 b) noexcept {
+  return {_mm_max_pd(a.lo, b.lo), _mm_max_pd(a.hi, b.hi)};
+}
+inline d4 less(const d4 a, const d4 b) noexcept {
+  return {_mm_cmplt_pd(a.lo, b.lo), _mm_cmplt_pd(a.hi, b.hi)};
+}
+inline d4 less_equal(const d4 a, const d4 b) noexcept {
+  return {_mm_cmple_pd(a.lo, b.lo), _mm_cmple_pd(a.hi, b.hi)};
+}
+inline d4 bit_and(const d4 a, const d4 b) noexcept {
+  return {_mm_and_pd(a.lo, b.lo), _mm_and_pd(a.hi, b.hi)};
+}
+inline d4 bit_or(const d4 a, const d4 b) noexcept {
+  return {_mm_or_pd(a.lo, b.lo), _mm_or_pd(a.hi, b.hi)};
+}
+inline d4 bit_andnot(const d4 a, const d4 b) noexcept {
+  return {_mm_andnot_pd(a.lo, b.lo), _mm_andnot_pd(a.hi, b.hi)};
+}
+inline uint32_t movemask(const d4 a) noexcept {
+  return static_cast<uint32_t>(_mm_movemask_pd(a.lo) |
+                               (_mm_movemask_pd(a.hi) << 2));
+}
+inline d4 from_bits(const uint32_t bits, const d4 *) noexcept {
+  const auto half = [](const uint32_t b) {
+    const __m128i lane_bits = _mm_set_epi32(0, 2, 0, 1);
+    const __m128i selected =
+        _mm_and_si128(_mm_set1_epi32(static_cast<int>(b)), lane_bits);
+    // Compare as 32-bit lanes, then smear each 64-bit lane's low half up
+    const __m128i equal = _mm_cmpeq_epi32(selected, lane_bits);
+    return _mm_castsi128_pd(
+        _mm_shuffle_epi32(equal, _MM_SHUFFLE(2, 2, 0, 0)));
+  };
+  return {half(bits), half(bits >> 2)};
+}
+#endif
+
+// No double estimate instruction below AVX-512; a divide is still cheaper
+// than three
+inline d4 rsqrt(const d4 a) noexcept { return div(broadcast(1.), sqrt(a)); }
+
+// Tag-dispatched load/broadcast for the 4-wide types so pack<> can name the
+// register type it wants
+inline f4 load(const float *p, const f4 *) noexcept { return load(p); }
+inline f4 broadcast(const float s, const f4 *) noexcept { return broadcast(s); }
+inline d4 load(const double *p, const d4 *) noexcept { return load(p); }
+inline d4 broadcast(const double s, const d4 *) noexcept {
+  return broadcast(s);
+}
+
+template <> struct native<float, 4> {
+  using type = f4;
+  using storage = f4;
+  static constexpr bool value{true};
+};
+template <> struct native<double, 4> {
+  using type = d4;
+  using storage = d4;
+  static constexpr bool value{true};
+};
+#if defined(RTM_SIMD_AVX)
+template <> struct native<float, 8> {
+  using type = f8;
+  using storage = f8;
+  static constexpr bool value{true};
+};
+#endif
+} // namespace detail
+#else
+namespace detail {
+// Without a vector unit no pack is NATIVE, so these are never called; they
+// are only declared to keep the register branches of pack<> well-formed
+template <typename... Args> void load(Args...) noexcept;
+template <typename... Args> void store(Args...) noexcept;
+template <typename... Args> void broadcast(Args...) noexcept;
+template <typename... Args> void add(Args...) noexcept;
+template <typename... Args> void sub(Args...) noexcept;
+template <typename... Args> void mul(Args...) noexcept;
+template <typename... Args> void div(Args...) noexcept;
+template <typename... Args> void negate(Args...) noexcept;
+template <typename... Args> void sqrt(Args...) noexcept;
+template <typename... Args> void rsqrt(Args...) noexcept;
+template <typename... Args> void min(Args...) noexcept;
+template <typename... Args> void max(Args...) noexcept;
+template <typename... Args> void less(Args...) noexcept;
+template <typename... Args> void less_equal(Args...) noexcept;
+template <typename... Args> void bit_and(Args...) noexcept;
+template <typename... Args> void bit_or(Args...) noexcept;
+template <typename... Args> void bit_andnot(Args...) noexcept;
+template <typename... Args> uint32_t movemask(Args...) noexcept;
+template <typename... Args> void from_bits(Args...) noexcept;
+} // namespace detail
+#endif
+
+// W lanes of T. Float/double packs the target has registers for compute
+// with intrinsics; every other combination (long double, 8 x double, no SIMD)
+// runs the same operations as plain lane loops, which is what the default
+// long double rtm::real gets.
+template <typename T, size_t W>
+  requires(std::floating_point<T> && W > 0 && W <= 32)
+class pack {
+  using native_type = typename detail::native<T, W>::type;
+
+public:
+  static constexpr size_t WIDTH{W};
+  static constexpr bool NATIVE{detail::native<T, W>::value};
+
+  // Per-lane predicate, bit i set for lane i
+  using mask_type = uint32_t;
+  static constexpr mask_type ALL_LANES{
+      W == 32 ? ~mask_type{} : (mask_type{1} << W) - 1};
+
+  pack() = default;
+
+  [[nodiscard]] static pack broadcast(const T scalar) noexcept {
+    pack temporary;
+    if constexpr (NATIVE)
+      temporary.m_value = detail::broadcast(scalar, tag());
+    else
+      temporary.m_value.fill(scalar);
+    return temporary;
+  }
+
+  [[nodiscard]] static pack load(const T *p) noexcept {
+    pack temporary;
+    if constexpr (NATIVE)
+      temporary.m_value = detail::load(p, tag());
+    else
+      std::copy(p, p + W, temporary.m_value.begin());
+    return temporary;
+  }
+
+  void store(T *p) const noexcept {
+    if constexpr (NATIVE)
+      detail::store(p, m_value);
+    else
+      std::copy(m_value.begin(), m_value.end(), p);
+  }
+
+  [[nodiscard]] T operator[](const size_t lane) const noexcept {
+    if constexpr (NATIVE) {
+      alignas(alignment_v<T, W>) T lanes[W];
+      store(lanes);
+      return lanes[lane];
+    } else {
+      return m_value[lane];
+    }
+  }
+
+  friend pack operator+(const pack &a, const pack &b) noexcept {
+    return zip(a, b, [](auto x, auto y) { return detail_add(x, y); });
+  }
+
+  friend pack operator-(const pack &a, const pack &b) noexcept {
+    return zip(a, b, [](auto x, auto y) { return detail_sub(x, y); });
+  }
+
+  friend pack operator*(const pack &a, const pack &b) noexcept {
+    return zip(a, b, [](auto x, auto y) { return detail_mul(x, y); });
+  }
+
+  friend pack operator/(const pack &a, const pack &b) noexcept {
+    return zip(a, b, [](auto x, auto y) { return detail_div(x, y); });
+  }
+
+  friend pack operator-(const pack &a) noexcept {
+    pack temporary;
+    if constexpr (NATIVE)
+      temporary.m_value = detail::negate(a.m_value);
+    else
+      for (size_t i = 0; i < W; ++i)
+        temporary.m_value[i] = -a.m_value[i];
+    return temporary;
+  }
+
+  friend pack sqrt(const pack &a) noexcept {
+    pack temporary;
+    if constexpr (NATIVE)
+      temporary.m_value = detail::sqrt(a.m_value);
+    else
+      for (size_t i = 0; i < W; ++i)
+        temporary.m_value[i] = std::sqrt(a.m_value[i]);
+    return temporary;
+  }
+
+  // 1 / sqrt(a); float registers use the refined estimate, about 22 bits
+  friend pack rsqrt(const pack &a) noexcept {
+    pack temporary;
+    if constexpr (NATIVE)
+      temporary.m_value = detail::rsqrt(a.m_value);
+    else
+      for (size_t i = 0; i < W; ++i)
+        temporary.m_value[i] = T{1} / std::sqrt(a.m_value[i]);
+    return temporary;
+  }
+
+  friend pack min(const pack &a, const pack &b) noexcept {
+    return zip(a, b, [](auto x, auto y) { return detail_min(x, y); });
+  }
+
+  friend pack max(const pack &a, const pack &b) noexcept {
+    return zip(a, b, [](auto x, auto y) { return detail_max(x, y); });
+  }
+
+  friend mask_type operator<(const pack &a, const pack &b) noexcept {
+    if constexpr (NATIVE)
+      return detail::movemask(detail::less(a.m_value, b.m_value));
+    else
+      return scalar_mask(a, b, [](T x, T y) { return x < y; });
+  }
+
+  friend mask_type operator<=(const pack &a, const pack &b) noexcept {
+    if constexpr (NATIVE)
+      return detail::movemask(detail::less_equal(a.m_value, b.m_value));
+    else
+      return scalar_mask(a, b, [](T x, T y) { return x <= y; });
+  }
+
+  friend mask_type operator>(const pack &a, const pack &b) noexcept {
+    return b < a;
+  }
+
+  friend mask_type operator>=(const pack &a, const pack &b) noexcept {
+    return b <= a;
+  }
+
+  // Lane i from a where bit i of mask is set, from b otherwise
+  friend pack select(const mask_type mask, const pack &a,
+                     const pack &b) noexcept {
+    pack temporary;
+    if constexpr (NATIVE) {
+      const auto lanes = detail::from_bits(mask, tag());
+      temporary.m_value = detail::bit_or(detail::bit_and(lanes, a.m_value),
+                                         detail::bit_andnot(lanes, b.m_value));
+    } else {
+      for (size_t i = 0; i < W; ++i)
+        temporary.m_value[i] = (mask >> i) & 1U ? a.m_value[i] : b.m_value[i];
+    }
+    return temporary;
+  }
+
+private:
+  typename detail::native<T, W>::storage m_value{};
+
+  static constexpr const native_type *tag() noexcept { return nullptr; }
+
+  // The scalar fallback reuses these for each lane, the native path for the
+  // whole register
+  template <typename V> static V detail_add(V a, V b) noexcept {
+    if constexpr (std::is_same_v<V, T>)
+      return a + b;
+    else
+      return detail::add(a, b);
+  }
+  template <typename V> static V detail_sub(V a, V b) noexcept {
+    if constexpr (std::is_same_v<V, T>)
+      return a - b;
+    else
+      return detail::sub(a, b);
+  }
+  template <typename V> static V detail_mul(V a, V b) noexcept {
+    if constexpr (std::is_same_v<V, T>)
+      return a * b;
+    else
+      return detail::mul(a, b);
+  }
+  template <typename V> static V detail_div(V a, V b) noexcept {
+    if constexpr (std::is_same_v<V, T>)
+      return a / b;
+    else
+      return detail::div(a, b);
+  }
+  template <typename V> static V detail_min(V a, V b) noexcept {
+    if constexpr (std::is_same_v<V, T>)
+      return a < b ? a : b; // minps semantics
+    else
+      return detail::min(a, b);
+  }
+  template <typename V> static V detail_max(V a, V b) noexcept {
+    if constexpr (std::is_same_v<V, T>)
+      return a > b ? a : b; // maxps semantics
+    else
+      return detail::max(a, b);
+  }
+
+  template <typename F>
+  static pack zip(const pack &a, const pack &b, F f) noexcept {
+    pack temporary;
+    if constexpr (NATIVE)
+      temporary.m_value = f(a.m_value, b.m_value);
+    else
+      for (size_t i = 0; i < W; ++i)
+        temporary.m_value[i] = f(a.m_value[i], b.m_value[i]);
+    return temporary;
+  }
+
+  template <typename F>
+  static mask_type scalar_mask(const pack &a, const pack &b, F f) noexcept {
+    mask_type mask{};
+    for (size_t i = 0; i < W; ++i)
+      if (f(a.m_value[i], b.m_value[i]))
+        mask |= mask_type{1} << i;
+    return mask;
+  }
+};
+} // namespace rtm::simd
+
+#endif
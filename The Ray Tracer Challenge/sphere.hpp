@@ -5,65 +5,198 @@
 #include "math_utils.hpp"
 #include "scene_object.hpp"
 #include "vec.hpp"
+#include <array>
 #include <memory>
+#include <optional>
 
 namespace rtm {
-class sphere : public object {
+// A sphere by centre and squared radius: all there is to a sphere whose
+// transform is no more than a uniform scale and a translation, and 16 bytes
+// in single precision
+struct sphere_shape {
+  vec<3, real> center{0, 0, 0};
+  real radius_squared{1};
+};
+
+// Where a ray meets the sphere, nearer root first, in the ray's own
+// parametrization; empty on a miss
+[[nodiscard]] constexpr std::optional<std::array<real, 2>>
+sphere_roots(const sphere_shape &shape, const rtm::ray<real> &ray) {
+  // The vector from the sphere's center to the ray's origin.
+  const vec4 sphere_to_ray{ray.origin.x() - shape.center.x(),
+                           ray.origin.y() - shape.center.y(),
+                           ray.origin.z() - shape.center.z(), 0};
+
+  // The standard ray-sphere intersection formula's components (a, b, c).
+  real a = dot_product(ray.direction, ray.direction);
+  real b = 2 * dot_product(ray.direction, sphere_to_ray);
+  real c = dot_product(sphere_to_ray, sphere_to_ray) - shape.radius_squared;
+
+  real discriminant = b * b - 4 * a * c;
+
+  // If the discriminant is negative, the ray misses the sphere.
+  if (discriminant < 0) {
+    return {}; // No roots.
+  }
+
+  // Calculate the two intersection points (t values).
+  auto sqrt_discriminant = c_sqrt(discriminant);
+  auto t1 = (-b - sqrt_discriminant) / (2 * a);
+  auto t2 = (-b + sqrt_discriminant) / (2 * a);
+
+  return {{t1, t2}};
+}
+
+[[nodiscard]] constexpr std::optional<std::array<real, 2>>
+unit_sphere_roots(const rtm::ray<real> &local_ray) {
+  return sphere_roots({}, local_ray);
+}
+
+// The shape of the unit sphere under a transform of any class but general
+[[nodiscard]] constexpr sphere_shape
+sphere_shape_of(const rtm::affine<real> &transform) {
+  return {{transform(0, 3), transform(1, 3), transform(2, 3)},
+          transform(0, 0) * transform(0, 0)};
+}
+
+class sphere final : public object {
 public:
-  sphere() = default;
+  sphere() : object{primitive_kind::sphere} {}
 
   static std::shared_ptr<sphere> make() { return std::make_shared<sphere>(); }
 
   material properties{};
 
+  [[nodiscard]] rtm::aabb<real> local_bounds() const override {
+    return {{-1, -1, -1}, {1, 1, 1}};
+  }
+
+  // Whether the sphere is described by shape() alone, which intersects world
+  // space rays without transforming them
+  [[nodiscard]] constexpr bool simple() const {
+    return classification() != transform_class::general;
+  }
+
+  // Centre and squared radius in world space; only meaningful if simple()
+  [[nodiscard]] constexpr sphere_shape shape() const {
+    return sphere_shape_of(transform());
+  }
+
+  // The kernels behind the virtual overrides, callable directly once the
+  // type is known (see visit_primitive())
+  [[nodiscard]] constexpr std::optional<rtm::intersects>
+  intersect_unit_sphere(const rtm::ray<real> &local_ray) const {
+    return intersect_shape({}, local_ray);
+  }
+
+  [[nodiscard]] constexpr std::optional<rtm::intersects>
+  intersect_shape(const sphere_shape &sh, const rtm::ray<real> &ray) const {
+    const auto roots = sphere_roots(sh, ray);
+    if (!roots)
+      return {};
+
+    return {{{{(*roots)[0], this}, {(*roots)[1], this}}}};
+  }
+
+  // The centre is the origin, so the point is its own normal
+  [[nodiscard]] static constexpr rtm::vec4
+  unit_sphere_normal(const rtm::vec4 &local_point) {
+    return local_point - vec4{0, 0, 0, 1};
+  }
+
+  // Same quadratic as above, one ray per lane
+  template <size_t W>
+  [[nodiscard]] rtm::packet_intersects<W, real>
+  intersect_unit_sphere(const rtm::ray_packet<W, real> &r) const {
+    return intersect_shape({}, r);
+  }
+
+  template <size_t W>
+  [[nodiscard]] rtm::packet_intersects<W, real>
+  intersect_shape(const sphere_shape &sh,
+                  const rtm::ray_packet<W, real> &r) const {
+    using pack_type = simd::pack<real, W>;
+
+    const auto zero = pack_type::broadcast(0);
+    const auto two = pack_type::broadcast(2);
+
+    const auto to_ray_x = r.origin_x - pack_type::broadcast(sh.center.x());
+    const auto to_ray_y = r.origin_y - pack_type::broadcast(sh.center.y());
+    const auto to_ray_z = r.origin_z - pack_type::broadcast(sh.center.z());
+
+    const auto a = r.direction_x * r.direction_x +
+                   r.direction_y * r.direction_y +
+                   r.direction_z * r.direction_z;
+    const auto b = two * (r.direction_x * to_ray_x +
+                          r.direction_y * to_ray_y +
+                          r.direction_z * to_ray_z);
+    const auto c = to_ray_x * to_ray_x + to_ray_y * to_ray_y +
+                   to_ray_z * to_ray_z -
+                   pack_type::broadcast(sh.radius_squared);
+
+    const auto discriminant = b * b - pack_type::broadcast(4) * a * c;
+    const auto mask = discriminant >= zero;
+
+    // Missed lanes get sqrt(0) rather than NaN, the mask discards them
+    const auto sqrt_discriminant = sqrt(max(discriminant, zero));
+    const auto two_a = two * a;
+
+    return {(-b - sqrt_discriminant) / two_a, (-b + sqrt_discriminant) / two_a,
+            mask, this};
+  }
+
 protected:
   [[nodiscard]] constexpr std::optional<rtm::intersects>
-  local_intersect(const rtm::ray<long double> &local_ray) override {
-    // The vector from the sphere's center (0,0,0) to the ray's origin.
-    auto sphere_to_ray = local_ray.origin - vec4{0, 0, 0, 1};
-
-    // The standard ray-sphere intersection formula's components (a, b, c).
-    long double a = dot_product(local_ray.direction, local_ray.direction);
-    long double b = 2 * dot_product(local_ray.direction, sphere_to_ray);
-    long double c = dot_product(sphere_to_ray, sphere_to_ray) -
-                    1; // -1 because it's a unit sphere (radius^2 = 1).
-
-    long double discriminant = b * b - 4 * a * c;
-
-    // If the discriminant is negative, the ray misses the sphere.
-    if (discriminant < 0) {
-      return {}; // Return an empty vector of intersections.
-    }
-
-    // Calculate the two intersection points (t values).
-    auto sqrt_discriminant = c_sqrt(discriminant);
-    auto t1 = (-b - sqrt_discriminant) / (2 * a);
-    auto t2 = (-b + sqrt_discriminant) / (2 * a);
-
-    // Use shared_from_this() to safely get a shared_ptr to this object.
-    // This is then implicitly converted to the weak_ptr in the intersect
-    // struct.
-    return {{{{t1, shared_from_this()}, {t2, shared_from_this()}}}};
+  local_intersect(const rtm::ray<real> &local_ray) const override {
+    return intersect_unit_sphere(local_ray);
+  }
+
+  [[nodiscard]] std::optional<rtm::intersects>
+  similar_intersect(const rtm::ray<real> &ray) const override {
+    return intersect_shape(shape(), ray);
+  }
+
+  [[nodiscard]] rtm::vec4
+  local_normal_at(const rtm::vec4 &local_point) const override {
+    return unit_sphere_normal(local_point);
+  }
+
+  [[nodiscard]] rtm::packet_intersects<4, real>
+  local_intersect_packet(
+      const rtm::ray_packet<4, real> &local_packet) const override {
+    return intersect_unit_sphere(local_packet);
+  }
+
+  [[nodiscard]] rtm::packet_intersects<8, real>
+  local_intersect_packet(
+      const rtm::ray_packet<8, real> &local_packet) const override {
+    return intersect_unit_sphere(local_packet);
   }
 };
 
 using normal = vec4;
 using sphere_obj = std::shared_ptr<sphere>;
 
-constexpr normal normal_at(const sphere_obj &sph, const vec4 &pt) {
-  vec4 object_point = sph->inverse_transform() * pt;
-  vec4 object_normal = object_point - vec4{0, 0, 0, 1};
+constexpr normal normal_at(const sphere &sph, const vec4 &pt) {
+  // Straight out from the centre, whatever the radius
+  if (sph.simple()) {
+    const auto center = sph.shape().center;
+    return normalize(
+        vec4{pt.x() - center.x(), pt.y() - center.y(), pt.z() - center.z(), 0});
+  }
 
-  vec4 world_normal =
-      matrix_transpose(sph->inverse_transform()) * object_normal;
+  const vec4 object_point = sph.inverse_transform().transform_point(pt);
 
-  world_normal.w() = 0;
+  return normalize(
+      sph.normal_to_world(sphere::unit_sphere_normal(object_point)));
+}
 
-  return normalize(world_normal);
+inline normal normal_at(const sphere_obj &sph, const vec4 &pt) {
+  return normal_at(*sph, pt);
 }
 
 constexpr vec4 reflect(const vec4 &in, const normal &n) {
-  return in - n * 2.L * dot_product(in, n);
+  return in - n * real{2} * dot_product(in, n);
 }
 } // namespace rtm
 
@@ -21,11 +21,14 @@ static constexpr void check_and_print(const Expected &expected_val,
   // At compile-time, choose which comparison to use.
   if constexpr (std::is_floating_point_v<std::decay_t<Actual>> ||
                 std::is_floating_point_v<std::decay_t<Expected>>) {
-    // Use are_close for floating-point types
-    if (!are_close(static_cast<long double>(actual),
-                   static_cast<long double>(expected_val))) {
+    // Use are_close for floating-point types; the reference is long double,
+    // the tolerance follows the precision the pipeline was built with
+    constexpr auto EPSILON = static_cast<long double>(constants::EPSILON_V<real>);
+
+    if (!are_close<long double, EPSILON>(static_cast<long double>(actual),
+                                         static_cast<long double>(expected_val))) {
       std::cerr << "\n--- TEST FAILED ---\n";
-      std::cerr << "  Precision used: EPSILON = " << constants::EPSILON << '\n';
+      std::cerr << "  Precision used: EPSILON = " << EPSILON << '\n';
       std::cerr << "  Expected:\n"
                 << std::setprecision(constants::PRECISION) << expected_val
                 << "\n";
@@ -35,7 +38,7 @@ static constexpr void check_and_print(const Expected &expected_val,
       throw std::logic_error("Precondition failed");
     }
     std::cout << "\n--- TEST PASSED ---\n";
-    std::cout << "  Precision used: EPSILON = " << constants::EPSILON << '\n';
+    std::cout << "  Precision used: EPSILON = " << EPSILON << '\n';
     std::cout << "  Expected:\n"
               << std::setprecision(constants::PRECISION) << expected_val
               << "\n";
@@ -0,0 +1,250 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace rtm {
+// Fixed-size pool of workers, each owning a task deque. A worker pops its own
+// work LIFO (cache-warm) and, once empty, steals FIFO from its siblings, so
+// uneven tasks (e.g. tiles on an object silhouette) balance themselves out.
+class thread_pool {
+public:
+  using task = std::function<void()>;
+
+  [[nodiscard]] static size_t default_thread_count() noexcept {
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+  }
+
+  explicit thread_pool(const size_t thread_count = default_thread_count()) {
+    if (thread_count == 0)
+      throw std::invalid_argument("thread_pool requires at least one worker");
+
+    m_queues.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i)
+      m_queues.push_back(std::make_unique<worker_queue>());
+
+    m_workers.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i)
+      m_workers.emplace_back([this, i] { worker_loop(i); });
+  }
+
+  ~thread_pool() {
+    {
+      std::scoped_lock lock{m_state_mutex};
+      m_stopping = true;
+    }
+    m_wake.notify_all();
+    m_workers.clear(); // join before the state below is torn down
+  }
+
+  thread_pool(const thread_pool &) = delete;
+  thread_pool(thread_pool &&) noexcept = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+  thread_pool &operator=(thread_pool &&) noexcept = delete;
+
+  [[nodiscard]] size_t size() const noexcept { return m_workers.size(); }
+
+  // Tasks submitted from a worker of this pool go to that worker's own deque,
+  // anything else is spread round-robin.
+  void submit(task t) {
+    const size_t target = current_worker_index().value_or(
+        m_next_queue.fetch_add(1, std::memory_order_relaxed) % size());
+
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+    // Counted before it is visible, so the count never drops below the
+    // tasks that can actually be taken
+    m_queued.fetch_add(1, std::memory_order_seq_cst);
+    try {
+      std::scoped_lock lock{m_queues[target]->mutex};
+      m_queues[target]->tasks.push_back(std::move(t));
+    } catch (...) {
+      // The deque is unchanged, so take the task back out of both counts;
+      // otherwise wait() never returns and workers spin on m_queued
+      m_queued.fetch_sub(1, std::memory_order_relaxed);
+      if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::scoped_lock lock{m_state_mutex};
+        m_idle.notify_all();
+      }
+      throw;
+    }
+
+    // Only a sleeping worker needs the state mutex; see worker_loop()
+    if (m_sleeping.load(std::memory_order_seq_cst) > 0) {
+      { std::scoped_lock lock{m_state_mutex}; }
+      m_wake.notify_one();
+    }
+  }
+
+  // Blocks until every submitted task has finished. Rethrows the first
+  // exception a task threw since the last wait. Not to be called from a
+  // worker of this pool.
+  void wait() {
+    std::unique_lock lock{m_state_mutex};
+    m_idle.wait(lock, [this] {
+      return m_pending.load(std::memory_order_acquire) == 0;
+    });
+
+    if (m_error) {
+      auto error = std::exchange(m_error, nullptr);
+      std::rethrow_exception(error);
+    }
+  }
+
+  // Runs f(i) for every i in [begin, end) and waits. The range is cut into
+  // about TASKS_PER_WORKER contiguous pieces per worker, one task each. If a
+  // submit() throws, the pieces already submitted still finish before the
+  // exception leaves, since they refer to f.
+  template <typename F>
+    requires std::invocable<F &, size_t>
+  void parallel_for(const size_t begin, const size_t end, F &&f) {
+    if (begin >= end)
+      return;
+
+    const size_t count = end - begin;
+    const size_t tasks = std::min(count, size() * TASKS_PER_WORKER);
+    try {
+      for (size_t task_index = 0; task_index < tasks; ++task_index) {
+        // Spread the remainder over the first pieces
+        const size_t first = begin + count * task_index / tasks;
+        const size_t last = begin + count * (task_index + 1) / tasks;
+        submit([&f, first, last] {
+          for (size_t i = first; i < last; ++i)
+            f(i);
+        });
+      }
+    } catch (...) {
+      // A task's own exception, if any, gives way to the submit failure
+      try {
+        wait();
+      } catch (...) {
+      }
+      throw;
+    }
+
+    wait();
+  }
+
+  // Tasks per worker that parallel_for() splits its range into, enough for
+  // stealing to even out uneven pieces
+  static constexpr size_t TASKS_PER_WORKER{4};
+
+private:
+  struct worker_queue {
+    std::mutex mutex;
+    std::deque<task> tasks;
+  };
+
+  std::vector<std::unique_ptr<worker_queue>> m_queues;
+  std::vector<std::jthread> m_workers;
+
+  std::atomic<size_t> m_next_queue{0};
+  std::atomic<size_t> m_pending{0}; // submitted but not yet finished
+
+  std::atomic<size_t> m_queued{0};   // sitting in some deque
+  std::atomic<size_t> m_sleeping{0}; // workers in (or entering) m_wake
+
+  // Guards sleeping and waking only, never the deques
+  std::mutex m_state_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_idle;
+  bool m_stopping{false};
+  std::exception_ptr m_error{};
+
+  struct worker_identity {
+    const thread_pool *pool{nullptr};
+    size_t index{0};
+  };
+
+  static worker_identity &this_worker() noexcept {
+    thread_local worker_identity identity{};
+    return identity;
+  }
+
+  [[nodiscard]] std::optional<size_t> current_worker_index() const noexcept {
+    const auto &identity = this_worker();
+    if (identity.pool == this)
+      return identity.index;
+    return std::nullopt;
+  }
+
+  bool try_pop(const size_t index, task &out) {
+    auto &queue = *m_queues[index];
+    std::scoped_lock lock{queue.mutex};
+    if (queue.tasks.empty())
+      return false;
+
+    out = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+  }
+
+  bool try_steal(const size_t thief, task &out) {
+    for (size_t offset = 1; offset < m_queues.size(); ++offset) {
+      auto &queue = *m_queues[(thief + offset) % m_queues.size()];
+      std::scoped_lock lock{queue.mutex};
+      if (queue.tasks.empty())
+        continue;
+
+      out = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      return true;
+    }
+    return false;
+  }
+
+  void run(task &t) {
+    try {
+      t();
+    } catch (...) {
+      std::scoped_lock lock{m_state_mutex};
+      if (!m_error)
+        m_error = std::current_exception();
+    }
+
+    if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      std::scoped_lock lock{m_state_mutex};
+      m_idle.notify_all();
+    }
+  }
+
+  // A worker announces itself in m_sleeping before it checks m_queued, and
+  // submit() bumps m_queued before it checks m_sleeping. Both are seq_cst,
+  // so at least one of them sees the other: either the worker finds the
+  // task, or submit() takes the mutex and its notify cannot be lost.
+  void worker_loop(const size_t index) {
+    this_worker() = {this, index};
+
+    while (true) {
+      task t;
+      if (try_pop(index, t) || try_steal(index, t)) {
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        run(t);
+        continue;
+      }
+
+      std::unique_lock lock{m_state_mutex};
+      m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+      m_wake.wait(lock, [this] {
+        return m_stopping || m_queued.load(std::memory_order_seq_cst) > 0;
+      });
+      m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+      if (m_stopping && m_queued.load(std::memory_order_relaxed) == 0)
+        return;
+    }
+  }
+};
+} // namespace rtm
+
+#endif
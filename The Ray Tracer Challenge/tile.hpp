@@ -0,0 +1,40 @@
+#ifndef TILE_HPP
+#define TILE_HPP
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace rtm {
+namespace constants {
+inline constexpr size_t TILE_SIZE{32};
+} // namespace constants
+
+// Half-open pixel rectangle [row_begin, row_end) x [col_begin, col_end)
+struct tile {
+  size_t row_begin{};
+  size_t col_begin{};
+  size_t row_end{};
+  size_t col_end{};
+};
+
+[[nodiscard]] inline std::vector<tile>
+make_tiles(const size_t width, const size_t height,
+           const size_t tile_size = constants::TILE_SIZE) {
+  if (tile_size == 0)
+    throw std::invalid_argument("Tile size must be non-zero");
+
+  std::vector<tile> tiles;
+  tiles.reserve(((width + tile_size - 1) / tile_size) *
+                ((height + tile_size - 1) / tile_size));
+
+  for (size_t r = 0; r < height; r += tile_size)
+    for (size_t c = 0; c < width; c += tile_size)
+      tiles.push_back({r, c, std::min(r + tile_size, height),
+                       std::min(c + tile_size, width)});
+
+  return tiles;
+}
+} // namespace rtm
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef VEC_HPP
 #define VEC_HPP
 #include "math_utils.hpp"
+#include "simd.hpp"
 #include <algorithm>
 #include <concepts>
 #include <iomanip>
@@ -57,6 +58,9 @@ public:
   [[nodiscard]] constexpr auto begin() const noexcept { return m_data.begin(); }
   [[nodiscard]] constexpr auto cbegin() const noexcept { return m_data.cbegin(); }
 
+  [[nodiscard]] constexpr T *data() noexcept { return m_data.data(); }
+  [[nodiscard]] constexpr const T *data() const noexcept { return m_data.data(); }
+
   [[nodiscard]] constexpr auto end() noexcept { return m_data.end(); }
   [[nodiscard]] constexpr auto end() const noexcept { return m_data.end(); }
   [[nodiscard]] constexpr auto cend() const noexcept { return m_data.end(); }
@@ -168,6 +172,13 @@ public:
   // modifying (*this) operators
 
   constexpr vec &operator+=(const vec &rhs) {
+    if constexpr (SIMD) {
+      if (!std::is_constant_evaluated()) {
+        simd::add(m_data.data(), rhs.m_data.data());
+        return *this;
+      }
+    }
+
     for (size_t i = 0; i < N; ++i)
       m_data[i] += rhs.m_data[i];
 
@@ -175,6 +186,13 @@ public:
   }
 
   constexpr vec &operator+=(const T scalar) {
+    if constexpr (SIMD) {
+      if (!std::is_constant_evaluated()) {
+        simd::add(m_data.data(), scalar);
+        return *this;
+      }
+    }
+
     for (size_t i = 0; i < N; ++i)
       m_data[i] += scalar;
 
@@ -182,6 +200,13 @@ public:
   }
 
   constexpr vec &operator-=(const vec &rhs) {
+    if constexpr (SIMD) {
+      if (!std::is_constant_evaluated()) {
+        simd::sub(m_data.data(), rhs.m_data.data());
+        return *this;
+      }
+    }
+
     for (size_t i = 0; i < N; ++i)
       m_data[i] -= rhs.m_data[i];
 
@@ -189,6 +214,13 @@ public:
   }
 
   constexpr vec &operator-=(const T scalar) {
+    if constexpr (SIMD) {
+      if (!std::is_constant_evaluated()) {
+        simd::sub(m_data.data(), scalar);
+        return *this;
+      }
+    }
+
     for (size_t i = 0; i < N; ++i)
       m_data[i] -= scalar;
 
@@ -197,6 +229,15 @@ public:
 
   constexpr vec operator-() const {
     vec temporary;
+
+    if constexpr (SIMD) {
+      if (!std::is_constant_evaluated()) {
+        temporary = *this;
+        simd::negate(temporary.m_data.data());
+        return temporary;
+      }
+    }
+
     for (size_t i = 0; i < N; ++i)
       temporary.m_data[i] = -m_data[i];
 
@@ -204,6 +245,13 @@ public:
   }
 
   constexpr vec &operator*=(const vec &rhs) {
+    if constexpr (SIMD) {
+      if (!std::is_constant_evaluated()) {
+        simd::mul(m_data.data(), rhs.m_data.data());
+        return *this;
+      }
+    }
+
     for (size_t i = 0; i < N; ++i)
       m_data[i] *= rhs.m_data[i];
 
@@ -211,6 +259,13 @@ public:
   }
 
   constexpr vec &operator*=(const T scalar) {
+    if constexpr (SIMD) {
+      if (!std::is_constant_evaluated()) {
+        simd::mul(m_data.data(), scalar);
+        return *this;
+      }
+    }
+
     for (size_t i = 0; i < N; ++i)
       m_data[i] *= scalar;
 
@@ -218,6 +273,13 @@ public:
   }
 
   constexpr vec &operator/=(const vec &rhs) {
+    if constexpr (SIMD) {
+      if (!std::is_constant_evaluated()) {
+        simd::div(m_data.data(), rhs.m_data.data());
+        return *this;
+      }
+    }
+
     for (size_t i = 0; i < N; ++i)
       m_data[i] /= rhs.m_data[i];
 
@@ -225,6 +287,13 @@ public:
   }
 
   constexpr vec &operator/=(const T scalar) {
+    if constexpr (SIMD) {
+      if (!std::is_constant_evaluated()) {
+        simd::div(m_data.data(), scalar);
+        return *this;
+      }
+    }
+
     for (size_t i = 0; i < N; ++i)
       m_data[i] /= scalar;
 
@@ -259,7 +328,11 @@ public:
   }
 
 private:
-  std::array<T, N> m_data{};
+  // vec<4, float> and vec<4, double> take the vector kernels at run time,
+  // constant evaluation and every other instantiation use the loops
+  static constexpr bool SIMD{simd::accelerated_v<T, N>};
+
+  alignas(simd::alignment_v<T, N>) std::array<T, N> m_data{};
 };
 
 template <size_t N, typename T>
@@ -314,56 +387,67 @@ constexpr vec<N, T> operator%(vec<N, T> lhs, const T scalar) {
   return lhs %= scalar;
 }
 
-template <typename T = void> struct Magnitude {
+template <typename T = void> struct DotProduct {
   template <size_t N, typename U>
-  [[nodiscard]] constexpr auto operator()(const vec<N, U> &v) const {
-    long double sum = 0.;
-    for (size_t i = 0; i < N; ++i) {
-      sum += static_cast<long double>(v[i] * v[i]);
+  [[nodiscard]] constexpr U operator()(const vec<N, U> &a,
+                                       const vec<N, U> &b) const {
+    if constexpr (simd::accelerated_v<U, N>) {
+      if (!std::is_constant_evaluated())
+        return simd::dot(a.data(), b.data());
     }
-    return std::sqrt(sum);
+
+    U temporary{};
+
+    for (size_t i = 0; i < N; ++i)
+      temporary += a[i] * b[i];
+
+    return temporary;
   }
 };
 
 template <size_t N, typename T>
-constexpr long double magnitude(const vec<N, T> &v) {
-  return Magnitude{}(v);
+constexpr T dot_product(const vec<N, T> &a, const vec<N, T> &b) {
+  return DotProduct{}(a, b);
 }
 
-template <typename T = void> struct Normalize {
-  template <size_t N, typename U>
-  [[nodiscard]] constexpr auto operator()(const vec<N, U> &v) {
-    vec<N, long double> temporary(v);
-    const auto current_magnitude = magnitude(v);
-
-    for (size_t i = 0; i < N; ++i)
-      temporary[i] /= current_magnitude;
+// Floating-point vectors are measured in their own precision, integral ones
+// are promoted to long double
+template <typename T>
+using magnitude_t =
+    std::conditional_t<std::floating_point<T>, T, long double>;
 
-    return temporary;
+template <typename T = void> struct Magnitude {
+  template <size_t N, typename U>
+  [[nodiscard]] constexpr auto operator()(const vec<N, U> &v) const {
+    if constexpr (std::floating_point<U>) {
+      return std::sqrt(dot_product(v, v));
+    } else {
+      magnitude_t<U> sum = 0.;
+      for (size_t i = 0; i < N; ++i) {
+        sum += static_cast<magnitude_t<U>>(v[i] * v[i]);
+      }
+      return std::sqrt(sum);
+    }
   }
 };
 
-template <typename U = long double, size_t N, typename T>
-constexpr vec<N, U> normalize(vec<N, T> v) {
-  return Normalize{}(v);
+template <size_t N, typename T>
+constexpr magnitude_t<T> magnitude(const vec<N, T> &v) {
+  return Magnitude{}(v);
 }
 
-template <typename T = void> struct DotProduct {
+template <typename T = void> struct Normalize {
   template <size_t N, typename U>
-  [[nodiscard]] constexpr U operator()(const vec<N, U> &a,
-                                       const vec<N, U> &b) const {
-    U temporary{};
-
-    for (size_t i = 0; i < N; ++i)
-      temporary += a[i] * b[i];
+  [[nodiscard]] constexpr auto operator()(const vec<N, U> &v) {
+    vec<N, magnitude_t<U>> temporary(v);
 
-    return temporary;
+    return temporary /= magnitude(v);
   }
 };
 
 template <size_t N, typename T>
-constexpr T dot_product(const vec<N, T> &a, const vec<N, T> &b) {
-  return DotProduct{}(a, b);
+constexpr vec<N, magnitude_t<T>> normalize(vec<N, T> v) {
+  return Normalize{}(v);
 }
 
 template <typename T = void> struct CrossProduct {
@@ -381,19 +465,19 @@ constexpr vec<4, T> cross_product(const vec<4, T> &a, const vec<4, T> b) {
   return CrossProduct{}(a, b);
 }
 
-using vec3 = vec<3, long double>;
-using vec4 = vec<4, long double>;
+using vec3 = vec<3, real>;
+using vec4 = vec<4, real>;
 using clr255 = vec<3, uint8_t>;
-using clr1 = vec<3, long double>;
+using clr1 = vec<3, real>;
 
 namespace constants {
 inline constexpr clr255 RED255{255, 0, 0};
 inline constexpr clr255 GRN255{0, 255, 0};
 inline constexpr clr255 BLU255{0, 0, 255};
 
-inline constexpr clr1 RED1{1.L, 0.L, 0.L};
-inline constexpr clr1 GRN1{0.L, 1.L, 0.L};
-inline constexpr clr1 BLU1{0.L, 0.L, 1.L};
+inline constexpr clr1 RED1{1, 0, 0};
+inline constexpr clr1 GRN1{0, 1, 0};
+inline constexpr clr1 BLU1{0, 0, 1};
 } // namespace constants
 } // namespace rtm
 #endif
@@ -0,0 +1,336 @@
+#ifndef WORLD_HPP
+#define WORLD_HPP
+
+#include "affine.hpp"
+#include "bounds.hpp"
+#include "intersection_list.hpp"
+#include "light_set.hpp"
+#include "material.hpp"
+#include "matrix.hpp"
+#include "ray.hpp"
+#include "sphere.hpp"
+#include "vec.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace rtm {
+// Scene container that owns its spheres by value in contiguous arrays rather
+// than one shared_ptr allocation each. What every ray touches is kept apart
+// from what only a hit needs (material, transforms, normal matrix), so the
+// intersection loops stream through nothing but the former:
+//  - spheres whose transform is at most a uniform scale and a translation
+//    are a sphere_shape, centre and squared radius, hit in world space;
+//  - the rest keep their inverse transform and world bounds.
+// Spheres are named by their index, which stays valid as the world grows.
+class world {
+public:
+  using handle = uint32_t;
+
+  // One entry of a bulk add_spheres()
+  struct sphere_description {
+    affine<real> transform{};
+    material properties{};
+  };
+
+  struct hit_record {
+    real t{};
+    handle object{};
+  };
+
+  light_set lights{};
+
+  world() = default;
+
+  // Room for this many spheres of either class without reallocating
+  void reserve(const size_t spheres) {
+    m_cold.reserve(spheres);
+    m_simple.reserve(spheres);
+    m_simple_handles.reserve(spheres);
+    m_general.reserve(spheres);
+    m_general_handles.reserve(spheres);
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return m_cold.size(); }
+
+  [[nodiscard]] bool empty() const noexcept { return m_cold.empty(); }
+
+  // How many spheres take the world-space path
+  [[nodiscard]] size_t simple_count() const noexcept {
+    return m_simple.size();
+  }
+
+  handle add_sphere(const affine<real> &transform = {},
+                    const material &properties = {}) {
+    const sphere_description description{transform, properties};
+    return add_spheres({&description, 1});
+  }
+
+  handle add_sphere(const matrix<4, 4, real> &transform,
+                    const material &properties = {}) {
+    return add_sphere(affine<real>{transform}, properties);
+  }
+
+  // Appends every description, growing each array at most once; returns
+  // the handle of the first one
+  handle add_spheres(std::span<const sphere_description> descriptions) {
+    if (descriptions.size() >
+        std::numeric_limits<handle>::max() - m_cold.size())
+      throw std::length_error("world: too many objects");
+
+    // All or nothing: a singular transform part way leaves the world as it
+    // was. Everything that can throw, inverting and allocating, happens
+    // before the world is touched.
+    std::vector<cold_data> added;
+    added.reserve(descriptions.size());
+    size_t simple_added = 0;
+    for (const auto &description : descriptions) {
+      added.push_back(make_cold(description.transform, description.properties));
+      if (added.back().classification != transform_class::general)
+        ++simple_added;
+    }
+
+    const size_t general_added = added.size() - simple_added;
+    grow(m_cold, added.size());
+    grow(m_simple, simple_added);
+    grow(m_simple_handles, simple_added);
+    grow(m_general, general_added);
+    grow(m_general_handles, general_added);
+
+    const auto first = static_cast<handle>(m_cold.size());
+    for (auto &cold : added) {
+      m_cold.push_back(std::move(cold));
+      place(static_cast<handle>(m_cold.size() - 1));
+    }
+    return first;
+  }
+
+  [[nodiscard]] const affine<real> &transform(const handle h) const {
+    return m_cold.at(h).transform;
+  }
+
+  [[nodiscard]] const affine<real> &inverse_transform(const handle h) const {
+    return m_cold.at(h).inverse_transform;
+  }
+
+  [[nodiscard]] transform_class classification(const handle h) const {
+    return m_cold.at(h).classification;
+  }
+
+  [[nodiscard]] const aabb<real> &bounds(const handle h) const {
+    return m_cold.at(h).bounds;
+  }
+
+  [[nodiscard]] const material &properties(const handle h) const {
+    return m_cold.at(h).properties;
+  }
+
+  [[nodiscard]] material &properties(const handle h) {
+    return m_cold.at(h).properties;
+  }
+
+  void set_transform(const handle h, const affine<real> &transform) {
+    auto cold = make_cold(transform, m_cold.at(h).properties);
+    if (cold.classification != transform_class::general) {
+      grow(m_simple, 1);
+      grow(m_simple_handles, 1);
+    } else {
+      grow(m_general, 1);
+      grow(m_general_handles, 1);
+    }
+
+    unplace(h);
+    m_cold[h] = std::move(cold);
+    place(h);
+  }
+
+  void set_transform(const handle h, const matrix<4, 4, real> &transform) {
+    set_transform(h, affine<real>{transform});
+  }
+
+  // Nearest non-negative hit over all spheres
+  [[nodiscard]] std::optional<hit_record>
+  closest_hit(const ray<real> &r) const {
+    std::optional<hit_record> closest;
+    real t_max = std::numeric_limits<real>::infinity();
+
+    const auto consider = [&](const std::optional<std::array<real, 2>> &roots,
+                              const handle h) {
+      if (!roots)
+        return;
+
+      for (const real t : *roots) {
+        if (t >= 0 && t < t_max) {
+          closest = hit_record{t, h};
+          t_max = t;
+          return;
+        }
+      }
+    };
+
+    for (size_t i = 0; i < m_simple.size(); ++i)
+      consider(sphere_roots(m_simple[i], r), m_simple_handles[i]);
+
+    const ray_slab<real> slab{r};
+    for (size_t i = 0; i < m_general.size(); ++i)
+      if (slab_entry(slab, m_general[i].bounds, real{}, t_max))
+        consider(unit_sphere_roots(
+                     transform_ray(m_general[i].inverse_transform, r)),
+                 m_general_handles[i]);
+
+    return closest;
+  }
+
+  // Whether any sphere is hit at a t in [0, t_max); for shadow rays
+  [[nodiscard]] bool any_hit(const ray<real> &r, const real t_max) const {
+    const auto blocks =
+        [t_max](const std::optional<std::array<real, 2>> &roots) {
+          return roots && (((*roots)[0] >= 0 && (*roots)[0] < t_max) ||
+                           ((*roots)[1] >= 0 && (*roots)[1] < t_max));
+        };
+
+    for (const auto &shape : m_simple)
+      if (blocks(sphere_roots(shape, r)))
+        return true;
+
+    const ray_slab<real> slab{r};
+    for (const auto &hot : m_general)
+      if (slab_entry(slab, hot.bounds, real{}, t_max) &&
+          blocks(unit_sphere_roots(transform_ray(hot.inverse_transform, r))))
+        return true;
+
+    return false;
+  }
+
+  // Appends both roots of every sphere the ray's line meets, simple spheres
+  // first; out is not cleared first
+  template <size_t N>
+  void intersect_all(const ray<real> &r,
+                     intersection_list<hit_record, N> &out) const {
+    const auto append = [&out](const std::optional<std::array<real, 2>> &roots,
+                               const handle h) {
+      if (roots) {
+        out.push_back({(*roots)[0], h});
+        out.push_back({(*roots)[1], h});
+      }
+    };
+
+    for (size_t i = 0; i < m_simple.size(); ++i)
+      append(sphere_roots(m_simple[i], r), m_simple_handles[i]);
+
+    for (size_t i = 0; i < m_general.size(); ++i) {
+      const auto local = transform_ray(m_general[i].inverse_transform, r);
+      append(unit_sphere_roots(local), m_general_handles[i]);
+    }
+  }
+
+  // Same as normal_at() on a sphere object with this transform
+  [[nodiscard]] normal normal_at(const handle h, const vec4 &point) const {
+    const auto &cold = m_cold.at(h);
+
+    if (cold.classification != transform_class::general) {
+      const auto center = sphere_shape_of(cold.transform).center;
+      return normalize(vec4{point.x() - center.x(), point.y() - center.y(),
+                            point.z() - center.z(), 0});
+    }
+
+    const vec4 object_normal = sphere::unit_sphere_normal(
+        cold.inverse_transform.transform_point(point));
+
+    return normalize(apply_normal_matrix(cold.normal_matrix, object_normal));
+  }
+
+private:
+  struct general_data {
+    affine<real> inverse_transform;
+    aabb<real> bounds;
+  };
+
+  struct cold_data {
+    affine<real> transform;
+    affine<real> inverse_transform;
+    matrix<3, 3, real> normal_matrix;
+    aabb<real> bounds;
+    material properties;
+    transform_class classification;
+    uint32_t slot; // index into m_simple or m_general
+  };
+
+  // Hot arrays, each with the handles of its entries alongside
+  std::vector<sphere_shape> m_simple{};
+  std::vector<handle> m_simple_handles{};
+  std::vector<general_data> m_general{};
+  std::vector<handle> m_general_handles{};
+
+  std::vector<cold_data> m_cold{};
+
+  // Appending within capacity cannot throw, which is what lets add_spheres()
+  // reserve first and then place without a way back
+  static_assert(std::is_nothrow_move_constructible_v<cold_data> &&
+                std::is_nothrow_move_assignable_v<cold_data>);
+  static_assert(std::is_nothrow_copy_constructible_v<sphere_shape>);
+  static_assert(std::is_nothrow_copy_constructible_v<general_data>);
+
+  // Capacity for added more elements, at least doubling when it grows
+  template <typename T>
+  static void grow(std::vector<T> &v, const size_t added) {
+    const size_t needed = v.size() + added;
+    if (needed > v.capacity())
+      v.reserve(std::max(needed, 2 * v.capacity()));
+  }
+
+  [[nodiscard]] static cold_data make_cold(const affine<real> &transform,
+                                           const material &properties) {
+    const auto inverse = affine_inverse(transform);
+
+    return {transform,
+            inverse,
+            normal_matrix(inverse),
+            transform_bounds(transform, aabb<real>{{-1, -1, -1}, {1, 1, 1}}),
+            properties,
+            classify(transform),
+            0};
+  }
+
+  // Adds h's hot entry to the array its class belongs in; never throws when
+  // that array has room
+  void place(const handle h) noexcept {
+    auto &cold = m_cold[h];
+
+    if (cold.classification != transform_class::general) {
+      cold.slot = static_cast<uint32_t>(m_simple.size());
+      m_simple.push_back(sphere_shape_of(cold.transform));
+      m_simple_handles.push_back(h);
+    } else {
+      cold.slot = static_cast<uint32_t>(m_general.size());
+      m_general.push_back({cold.inverse_transform, cold.bounds});
+      m_general_handles.push_back(h);
+    }
+  }
+
+  // Removes h's hot entry, moving the last one of the array into its slot
+  void unplace(const handle h) noexcept {
+    const auto erase = [this](auto &hot, std::vector<handle> &handles,
+                              const uint32_t slot) {
+      hot[slot] = hot.back();
+      handles[slot] = handles.back();
+      m_cold[handles[slot]].slot = slot;
+      hot.pop_back();
+      handles.pop_back();
+    };
+
+    const auto &cold = m_cold[h];
+    if (cold.classification != transform_class::general)
+      erase(m_simple, m_simple_handles, cold.slot);
+    else
+      erase(m_general, m_general_handles, cold.slot);
+  }
+};
+} // namespace rtm
+
+#endif
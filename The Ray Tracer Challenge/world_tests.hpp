@@ -0,0 +1,236 @@
+#ifndef WORLD_TESTS_HPP
+#define WORLD_TESTS_HPP
+
+#include "primitive.hpp"
+#include "sphere.hpp"
+#include "test_helpers.hpp"
+#include "world.hpp"
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace rtm::testing {
+inline void perform_world_tests() {
+  // Spheres live by value; hot and cold parts read back per handle
+  {
+    world w;
+    expected(true, w.empty());
+
+    material shiny{};
+    shiny.shininess = 50;
+    const auto a = w.add_sphere(matrix_translate<real>({1, 2, 3}), shiny);
+    const auto b = w.add_sphere();
+
+    expected(world::handle{0}, a);
+    expected(world::handle{1}, b);
+    expected(size_t{2}, w.size());
+    expected(real{50}, w.properties(a).shininess);
+    expected(matrix_translate<real>({1, 2, 3}), w.transform(a).to_matrix());
+    expected(matrix_translate<real>({-1, -2, -3}),
+             w.inverse_transform(a).to_matrix());
+    expected(vec<3, real>{0, 1, 2}, w.bounds(a).min);
+
+    w.set_transform(b, matrix_scale<real>({2, 2, 2}));
+    expected(vec<3, real>{2, 2, 2}, w.bounds(b).max);
+    expected(normal{1, 0, 0, 0}, w.normal_at(b, vec4{2, 0, 0, 1}));
+
+    w.properties(b).color = {1, 0, 0};
+    expected(clr1{1, 0, 0}, w.properties(b).color);
+  }
+
+  // Spheres move between the simple and general arrays as their transform
+  // changes, and every handle keeps hitting its own sphere
+  {
+    world w;
+    const auto a = w.add_sphere(matrix_translate<real>({0, 0, 5}));
+    const auto b = w.add_sphere(matrix_translate<real>({0, 0, 10}) *
+                                matrix_scale<real>({2, 1, 1}));
+    const auto c = w.add_sphere(matrix_translate<real>({0, 0, 15}) *
+                                matrix_scale<real>({3, 3, 3}));
+
+    expected(transform_class::translation, w.classification(a));
+    expected(transform_class::general, w.classification(b));
+    expected(transform_class::uniform_scale, w.classification(c));
+    expected(size_t{2}, w.simple_count());
+
+    const ray<real> r{{0, 0, 0, 1}, {0, 0, 1, 0}};
+    expected(a, w.closest_hit(r)->object);
+
+    // a becomes general and moves out of the way, b becomes simple
+    w.set_transform(a, matrix_translate<real>({0, 0, 30}) *
+                           matrix_scale<real>({1, 1, 2}));
+    w.set_transform(b, matrix_translate<real>({0, 0, 20}));
+    expected(size_t{2}, w.simple_count());
+
+    const auto first = w.closest_hit(r);
+    expected(c, first->object);
+    expected(real{12}, first->t);
+
+    w.set_transform(c, matrix_translate<real>({0, 0, 40}));
+    expected(b, w.closest_hit(r)->object);
+    expected(true, w.any_hit(r, 20));
+    expected(false, w.any_hit(r, 18));
+
+    w.set_transform(b, matrix_translate<real>({0, 5, 0}));
+    expected(a, w.closest_hit(r)->object);
+    expected(real{28}, w.closest_hit(r)->t);
+    expected(normal{0, 1, 0, 0}, w.normal_at(b, vec4{0, 6, 0, 1}));
+  }
+
+  // Small spheres are not mistaken for singular ones
+  {
+    world w;
+    const auto tiny = w.add_sphere(matrix_translate<real>({0, 0, 5}) *
+                                   matrix_scale<real>({0.01L, 0.01L, 0.01L}));
+    const auto flat = w.add_sphere(matrix_translate<real>({0, 1, 5}) *
+                                   matrix_scale<real>({0.01L, 0.02L, 0.01L}));
+
+    expected(transform_class::uniform_scale, w.classification(tiny));
+    expected(transform_class::general, w.classification(flat));
+    expected(tiny, w.closest_hit({{0, 0, 0, 1}, {0, 0, 1, 0}})->object);
+    expected(flat, w.closest_hit({{0, 1, 0, 1}, {0, 0, 1, 0}})->object);
+  }
+
+  // A singular transform in a bulk add leaves the world untouched, both hot
+  // arrays included, wherever in the batch it comes
+  {
+    world w;
+    const auto simple = w.add_sphere(matrix_translate<real>({0, 0, 5}));
+    const auto general = w.add_sphere(matrix_translate<real>({0, 3, 5}) *
+                                      matrix_scale<real>({1, 2, 1}));
+
+    const std::vector<world::sphere_description> descriptions{
+        {affine<real>{matrix_translate<real>({0, 0, 2})}, {}},
+        {affine<real>{matrix_translate<real>({0, -5, 0}) *
+                      matrix_scale<real>({1, 3, 1})},
+         {}},
+        {affine<real>{matrix_scale<real>({1, 0, 1})}, {}},
+        {affine<real>{matrix_translate<real>({0, 0, 1})}, {}}};
+
+    bool threw = false;
+    try {
+      w.add_spheres(descriptions);
+    } catch (const std::domain_error &) {
+      threw = true;
+    }
+
+    expected(true, threw);
+    expected(size_t{2}, w.size());
+    expected(size_t{1}, w.simple_count());
+
+    const ray<real> along_z{{0, 0, 0, 1}, {0, 0, 1, 0}};
+    const ray<real> above{{0, 3, 0, 1}, {0, 0, 1, 0}};
+    expected(simple, w.closest_hit(along_z)->object);
+    expected(general, w.closest_hit(above)->object);
+
+    // A reservation that cannot be met throws before anything changes
+    threw = false;
+    try {
+      w.reserve(std::numeric_limits<size_t>::max());
+    } catch (const std::length_error &) {
+      threw = true;
+    }
+
+    expected(true, threw);
+
+    // The world keeps working: the batch without its bad entry goes in
+    const auto first = w.add_spheres({descriptions.data(), 2});
+    expected(world::handle{2}, first);
+    expected(size_t{2}, w.simple_count());
+    expected(first, w.closest_hit(along_z)->object);
+  }
+
+  // A bulk-added world hits exactly what the same spheres as objects do.
+  // Exact only while the compiler keeps multiply-adds apart, as MSVC's
+  // default /fp:precise does; GCC and Clang need -ffp-contract=off
+  {
+    std::mt19937 engine{99};
+    std::uniform_real_distribution<double> position{-15, 15};
+    std::uniform_real_distribution<double> size{0.3, 2};
+    std::uniform_real_distribution<double> unit{-1, 1};
+
+    const auto random_real = [&engine](auto &distribution) {
+      return static_cast<real>(distribution(engine));
+    };
+
+    // Cycles through a pure translation, a translation with uniform scale
+    // and a general transform, so both hot arrays see random rays
+    const auto random_transform = [&](const size_t kind) {
+      const auto translation = matrix_translate<real>(
+          {random_real(position), random_real(position),
+           random_real(position)});
+      if (kind % 3 == 0)
+        return translation;
+
+      const real scale = random_real(size);
+      if (kind % 3 == 1)
+        return translation * matrix_scale<real>({scale, scale, scale});
+
+      return translation *
+             matrix_scale<real>({scale, random_real(size), random_real(size)});
+    };
+
+    std::vector<world::sphere_description> descriptions;
+    std::vector<std::shared_ptr<object>> objects;
+    for (size_t i = 0; i < 200; ++i) {
+      const auto transform = random_transform(i);
+
+      descriptions.push_back({affine<real>{transform}, {}});
+      auto s = sphere::make();
+      s->set_transform(transform);
+      objects.push_back(s);
+    }
+
+    world w;
+    expected(world::handle{0}, w.add_spheres(descriptions));
+    expected(true, w.simple_count() > 0 && w.simple_count() < objects.size());
+
+    intersection_list<world::hit_record> xs;
+    size_t hits = 0;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < 1000; ++i) {
+      // Now and then a sphere changes class, moving between the hot arrays
+      if (i % 50 == 49) {
+        const auto h = static_cast<world::handle>(engine() % objects.size());
+        const auto transform = random_transform(engine());
+        w.set_transform(h, transform);
+        objects[h]->set_transform(transform);
+      }
+
+      const ray<real> r{{random_real(position), random_real(position),
+                         random_real(position), 1},
+                        {random_real(unit), random_real(unit),
+                         random_real(unit), 0}};
+
+      const auto reference = closest_hit(objects, r);
+      const auto h = w.closest_hit(r);
+
+      if (reference.has_value() != h.has_value()) {
+        ++mismatches;
+      } else if (reference) {
+        ++hits;
+        if (reference->t != h->t ||
+            reference->object != objects[h->object].get())
+          ++mismatches;
+      }
+
+      const real t_max = random_real(size) * 10;
+      if ((reference && reference->t < t_max) != w.any_hit(r, t_max))
+        ++mismatches;
+
+      xs.clear();
+      w.intersect_all(r, xs);
+      const auto nearest = xs.hit();
+      if (h.has_value() != nearest.has_value() ||
+          (h && (h->t != nearest->t || h->object != nearest->object)))
+        ++mismatches;
+    }
+
+    expected(true, hits > 0);
+    expected(size_t{0}, mismatches);
+  }
+}
+} // namespace rtm::testing
+
+#endif